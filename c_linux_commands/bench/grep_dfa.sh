@@ -0,0 +1,77 @@
+#!/bin/bash
+# grep --dfa (지연 DFA + 고정 문자열 필터) 와 regexec() 비교 (user-008)
+# 로그 말뭉치에서 여러 패턴을 -E 와 --dfa -E 로 각각 재고, 출력이 같은지도 확인한다.
+#
+# 사용법: bash bench/grep_dfa.sh [로그 파일]   (없으면 약 48 MB 짜리 로그를 만든다)
+#         GREP=<바이너리> 로 미리 빌드한 grep 을 지정할 수 있다
+
+set -eu
+dir=$(cd "$(dirname "$0")/.." && pwd)
+work=$(mktemp -d)
+trap 'rm -rf "$work"' EXIT
+
+grep_bin=${GREP:-}
+if [ -z "$grep_bin" ]; then
+    gcc -O2 -pthread "$dir/c_files/grep.c" -o "$work/grep"
+    grep_bin=$work/grep
+fi
+
+corpus=${1:-}
+if [ -z "$corpus" ]; then
+    corpus=$work/corpus.log
+    awk 'BEGIN {
+        srand(530)
+        split("INFO INFO INFO INFO DEBUG WARN ERROR", level, " ")
+        split("alice bob carol dave erin frank", user, " ")
+        split("ok ok ok timeout refused reset", result, " ")
+        split("GET POST PUT DELETE", method, " ")
+        for (i = 0; i < 600000; i++) {
+            printf "2024-05-30 %02d:%02d:%02d.%03d %s user=%s%d %s /api/v%d/item/%d %s %d.%dms\n",
+                int(i / 25000) % 24, int(i / 400) % 60, i % 60, i % 1000,
+                level[int(rand() * 7) + 1], user[int(rand() * 6) + 1], int(rand() * 100),
+                method[int(rand() * 4) + 1], int(rand() * 3) + 1, int(rand() * 100000),
+                result[int(rand() * 6) + 1], int(rand() * 900), int(rand() * 10)
+        }
+    }' > "$corpus"
+fi
+
+patterns=(
+    'ERROR .* timeout'                                  # 고정 문자열 필터가 듣는 경우
+    '(WARN|ERROR) user=[a-z]+[0-9]+ (POST|PUT)'         # 교대 + 문자 클래스
+    '[0-9]{3}\.[0-9]ms$'                                # 쓸 만한 고정 문자열이 없음
+    '^[0-9]{4}-[0-9]{2}-[0-9]{2} 1[0-9]:[0-5][0-9]'     # 앵커 + 반복
+    'user=(alice|bob)[0-9]* GET /api/v2/item/[0-9]+ reset'
+)
+
+# 가장 빠른 3 회의 시간(초)
+time_run() {
+    local best=""
+    for _ in 1 2 3; do
+        local start end
+        start=$(date +%s.%N)
+        "$@" > /dev/null
+        end=$(date +%s.%N)
+        best=$(awk -v a="$start" -v b="$end" -v best="$best" \
+            'BEGIN { t = b - a; if (best == "" || t < best) best = t; printf "%.4f", best }')
+    done
+    echo "$best"
+}
+
+size=$(wc -c < "$corpus")
+printf '말뭉치: %s (%.1f MB)\n\n' "$corpus" "$(awk -v s="$size" 'BEGIN { print s / 1048576 }')"
+printf '%10s %10s %8s  %s\n' "regexec s" "--dfa s" "speedup" "pattern"
+
+for pattern in "${patterns[@]}"; do
+    expected=$("$grep_bin" -E "$pattern" "$corpus" | md5sum)
+    actual=$("$grep_bin" --dfa -E "$pattern" "$corpus" | md5sum)
+    if [ "$expected" != "$actual" ]; then
+        echo "출력이 다릅니다: $pattern" >&2
+        exit 1
+    fi
+    
+    t_regex=$(time_run "$grep_bin" -E "$pattern" "$corpus")
+    t_dfa=$(time_run "$grep_bin" --dfa -E "$pattern" "$corpus")
+    awk -v r="$t_regex" -v d="$t_dfa" -v p="$pattern" 'BEGIN {
+        printf "%10.3f %10.3f %7.1fx  %s\n", r, d, r / d, p
+    }'
+done
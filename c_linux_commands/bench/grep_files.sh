@@ -0,0 +1,78 @@
+#!/bin/bash
+# grep 의 파일 수에 따른 처리량 측정 (user-001: 패턴을 main() 에서 한 번만 컴파일)
+# 작은 로그 조각 N 개를 만들고 grep -r 를 -j 1 과 -j <코어 수> 로 각각 잰다.
+#
+# 사용법: bash bench/grep_files.sh [파일 수...]   (기본: 1000 5000 20000 50000)
+#         GREP=<바이너리> 로 미리 빌드한 grep 을 지정할 수 있다
+
+set -eu
+dir=$(cd "$(dirname "$0")/.." && pwd)
+work=$(mktemp -d)
+trap 'rm -rf "$work"' EXIT
+
+counts=("$@")
+if [ ${#counts[@]} -eq 0 ]; then
+    counts=(1000 5000 20000 50000)
+fi
+jobs=$(nproc)
+pattern='ERROR [a-z]+ timeout'
+
+grep_bin=${GREP:-}
+if [ -z "$grep_bin" ]; then
+    gcc -O2 -pthread "$dir/c_files/grep.c" -o "$work/grep"
+    grep_bin=$work/grep
+fi
+
+# 조각 하나: 40 줄, 그중 한 줄만 매치
+make_shards() {
+    local n=$1 out=$2
+    mkdir -p "$out"
+    awk -v n="$n" -v out="$out" 'BEGIN {
+        for (f = 0; f < n; f++) {
+            path = sprintf("%s/shard%06d.log", out, f)
+            for (i = 0; i < 40; i++) {
+                if (i == f % 40) {
+                    printf "2024-05-30 12:%02d:%02d ERROR worker timeout id=%d\n", i, f % 60, f > path
+                } else {
+                    printf "2024-05-30 12:%02d:%02d INFO request ok id=%d line=%d\n", i, f % 60, f, i > path
+                }
+            }
+            close(path)
+        }
+    }'
+}
+
+# 가장 빠른 3 회의 시간(초)
+time_run() {
+    local best=""
+    for _ in 1 2 3; do
+        local start end
+        start=$(date +%s.%N)
+        "$@" > /dev/null
+        end=$(date +%s.%N)
+        best=$(awk -v a="$start" -v b="$end" -v best="$best" \
+            'BEGIN { t = b - a; if (best == "" || t < best) best = t; printf "%.4f", best }')
+    done
+    echo "$best"
+}
+
+printf '%8s %8s %10s %12s %10s %12s %10s\n' files MB "-j1 s" "-j1 files/s" "-j$jobs s" "-j$jobs files/s" "MB/s"
+for n in "${counts[@]}"; do
+    shards=$work/shards$n
+    make_shards "$n" "$shards"
+    mb=$(find "$shards" -type f -printf '%s\n' | awk '{ s += $1 } END { printf "%.1f", s / 1048576 }')
+    
+    # 출력이 맞는지 먼저 확인한다 (조각마다 한 줄)
+    matched=$("$grep_bin" -r -c -E "$pattern" "$shards" | awk -F: '{ s += $NF } END { print s }')
+    if [ "$matched" != "$n" ]; then
+        echo "매치 수가 다릅니다: $matched (기대 $n)" >&2
+        exit 1
+    fi
+    
+    t1=$(time_run "$grep_bin" -j 1 -r -E "$pattern" "$shards")
+    tn=$(time_run "$grep_bin" -j "$jobs" -r -E "$pattern" "$shards")
+    awk -v n="$n" -v mb="$mb" -v t1="$t1" -v tn="$tn" -v jobs="$jobs" 'BEGIN {
+        printf "%8d %8.1f %10.3f %12.0f %10.3f %12.0f %10.1f\n", n, mb, t1, n / t1, tn, n / tn, mb / tn
+    }'
+    rm -rf "$shards"
+done
@@ -1,64 +1,340 @@
+#define _GNU_SOURCE
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/sendfile.h>
+#include <sys/uio.h>
 
-int main(int argc, char* argv[]) {
-    int show_line_numbers = 0;
-    int start_idx = 1;
-    
-    if (argc > 1 && strcmp(argv[1], "-n") == 0) {
-        show_line_numbers = 1;
-        start_idx = 2;
-    }
+#define CAT_BUFFER_SIZE (128 * 1024)    // read/write 로 옮길 때의 버퍼 크기
+#define CAT_CHUNK_SIZE (1L << 30)       // 커널 복사 호출 한 번에 넘기는 최대 크기
+#define CAT_PIPE_SIZE (1024 * 1024)     // splice 전에 늘려 볼 파이프 용량
+#define CAT_NUMBER_BLOCK (128 * 1024)   // -n 에서 한 번에 읽는 블록 크기
+#define CAT_OUT_SIZE (256 * 1024)       // 번호와 짧은 줄을 모아 두는 출력 버퍼
+#define CAT_IOV_COUNT 1024              // writev 한 번에 넘기는 조각 수 (IOV_MAX)
+#define CAT_COPY_MAX 256                // 이보다 긴 줄은 복사하지 않고 iovec 으로 가리킨다
+#define CAT_NUMBER_WIDTH 24             // 줄 번호 문자열 자리 (숫자 + '\t')
+
+// 커널 복사가 이 조합을 지원하지 않는다는 뜻의 오류인지
+static int unsupported(int err) {
+    return err == EINVAL || err == ENOSYS || err == EXDEV || err == EOPNOTSUPP ||
+           err == EBADF || err == ESPIPE;
+}
+
+// 평범한 read/write 복사 (커널 경로를 쓸 수 없을 때)
+int copy_read_write(int in, int out) {
+    static char buffer[CAT_BUFFER_SIZE];
     
-    if (argc < start_idx + 1) {
-        char c;
-        int line_number = 1;
-        
-        if (show_line_numbers) {
-            printf("%6d\t", line_number);
+    for (;;) {
+        ssize_t n = read(in, buffer, sizeof(buffer));
+        if (n == 0) {
+            return 0;
+        }
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
         }
         
-        while ((c = getchar()) != EOF) {
-            putchar(c);
-            if (c == '\n' && show_line_numbers) {
-                line_number++;
-                if ((c = getchar()) != EOF) {
-                    printf("%6d\t", line_number);
-                    putchar(c);
+        for (ssize_t done = 0; done < n; ) {
+            ssize_t w = write(out, buffer + done, n - done);
+            if (w < 0) {
+                if (errno == EINTR) {
+                    continue;
                 }
+                return -1;
+            }
+            done += w;
+        }
+    }
+}
+
+// in 의 현재 위치부터 끝까지 out 으로 보낸다.
+// 일반 파일끼리는 copy_file_range, 파이프로는 splice, 그 밖에 입력이 일반 파일이면 sendfile,
+// 어느 것도 안 되면 read/write 로 옮긴다. 커널 호출은 파일 위치를 옮겨 두므로
+// 중간에 지원하지 않는다는 오류가 나도 이어서 read/write 로 넘어가면 된다.
+int copy_fd(int in, int out) {
+    struct stat in_st, out_st;
+    
+    if (fstat(in, &in_st) != 0 || fstat(out, &out_st) != 0) {
+        return -1;
+    }
+    
+    if (S_ISREG(in_st.st_mode) && S_ISREG(out_st.st_mode)) {
+        for (;;) {
+            ssize_t n = copy_file_range(in, NULL, out, NULL, CAT_CHUNK_SIZE, 0);
+            if (n > 0) {
+                continue;
+            }
+            if (n == 0) {
+                return 0;
+            }
+            if (errno == EINTR) {
+                continue;
+            }
+            if (!unsupported(errno)) {
+                return -1;
+            }
+            break;
+        }
+    } else if (S_ISFIFO(out_st.st_mode)) {
+        fcntl(out, F_SETPIPE_SZ, CAT_PIPE_SIZE);    // 실패해도 기본 용량으로 진행
+        for (;;) {
+            ssize_t n = splice(in, NULL, out, NULL, CAT_CHUNK_SIZE, SPLICE_F_MOVE | SPLICE_F_MORE);
+            if (n > 0) {
+                continue;
             }
+            if (n == 0) {
+                return 0;
+            }
+            if (errno == EINTR) {
+                continue;
+            }
+            if (!unsupported(errno)) {
+                return -1;
+            }
+            break;
         }
+    } else if (S_ISREG(in_st.st_mode)) {
+        for (;;) {
+            ssize_t n = sendfile(out, in, NULL, CAT_CHUNK_SIZE);
+            if (n > 0) {
+                continue;
+            }
+            if (n == 0) {
+                return 0;
+            }
+            if (errno == EINTR) {
+                continue;
+            }
+            if (!unsupported(errno)) {
+                return -1;
+            }
+            break;
+        }
+    }
+    
+    if (S_ISREG(in_st.st_mode)) {
+        posix_fadvise(in, 0, 0, POSIX_FADV_SEQUENTIAL);
+    }
+    return copy_read_write(in, out);
+}
+
+// 입력이 출력 파일 자신이면 끝없이 커지므로 거절한다
+int same_as_output(int in) {
+    struct stat in_st, out_st;
+    
+    if (fstat(in, &in_st) != 0 || fstat(STDOUT_FILENO, &out_st) != 0) {
         return 0;
     }
+    return S_ISREG(in_st.st_mode) && S_ISREG(out_st.st_mode) &&
+           in_st.st_dev == out_st.st_dev && in_st.st_ino == out_st.st_ino &&
+           in_st.st_size > 0;
+}
+
+// 번호 붙이기 (-n)
+
+// 다음에 찍을 줄 번호. printf 대신 오른쪽 정렬된 십진 문자열을 제자리에서 1씩 올린다.
+typedef struct {
+    char text[CAT_NUMBER_WIDTH];   // 끝은 '\t', 그 앞이 숫자
+    int start;                      // 출력이 시작하는 위치 ("%6d\t" 너비)
+} line_number;
+
+void number_init(line_number* number) {
+    memset(number->text, ' ', CAT_NUMBER_WIDTH);
+    number->text[CAT_NUMBER_WIDTH - 1] = '\t';
+    number->text[CAT_NUMBER_WIDTH - 2] = '1';
+    number->start = CAT_NUMBER_WIDTH - 7;
+}
+
+void number_next(line_number* number) {
+    int i = CAT_NUMBER_WIDTH - 2;
     
-    for (int i = start_idx; i < argc; i++) {
-        FILE* file = fopen(argv[i], "r");
-        if (!file) {
-            perror("cat");
-            continue;
+    while (number->text[i] == '9') {
+        number->text[i--] = '0';
+    }
+    if (number->text[i] == ' ') {
+        number->text[i] = '1';
+        if (i < number->start) {
+            number->start = i;
+        }
+    } else {
+        number->text[i]++;
+    }
+}
+
+// 번호와 짧은 줄은 out 에 복사해 모으고, 긴 줄은 입력 블록을 그대로 가리키는
+// iovec 으로 넘겨서 블록마다 writev 한 번으로 내보낸다.
+typedef struct {
+    char out[CAT_OUT_SIZE];
+    size_t out_len;
+    size_t sealed;          // out 에서 이미 iovec 에 들어간 부분
+    struct iovec iov[CAT_IOV_COUNT];
+    int iov_count;
+} numbered_output;
+
+static numbered_output output;
+
+int writev_all(struct iovec* iov, int count) {
+    while (count > 0) {
+        ssize_t n = writev(STDOUT_FILENO, iov, count);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+        while (count > 0 && (size_t)n >= iov->iov_len) {
+            n -= iov->iov_len;
+            iov++;
+            count--;
+        }
+        if (count > 0) {
+            iov->iov_base = (char*)iov->iov_base + n;
+            iov->iov_len -= n;
+        }
+    }
+    return 0;
+}
+
+// out 에 쌓인 뒤 아직 iovec 에 안 들어간 부분을 하나로 묶는다
+void output_seal(numbered_output* o) {
+    if (o->out_len > o->sealed) {
+        o->iov[o->iov_count].iov_base = o->out + o->sealed;
+        o->iov[o->iov_count].iov_len = o->out_len - o->sealed;
+        o->iov_count++;
+        o->sealed = o->out_len;
+    }
+}
+
+int output_flush(numbered_output* o) {
+    output_seal(o);
+    int result = writev_all(o->iov, o->iov_count);
+    o->iov_count = 0;
+    o->out_len = 0;
+    o->sealed = 0;
+    return result;
+}
+
+int output_add(numbered_output* o, const char* data, size_t len) {
+    // seal 과 긴 줄 참조가 각각 iovec 하나씩 쓸 수 있어야 하고,
+    // out 의 남은 자리는 실제로 복사해 넣는 짧은 줄에만 따진다
+    int copy = len <= CAT_COPY_MAX;
+    if (o->iov_count + 2 > CAT_IOV_COUNT || (copy && o->out_len + len > CAT_OUT_SIZE)) {
+        if (output_flush(o) != 0) {
+            return -1;
+        }
+    }
+    
+    if (copy) {
+        memcpy(o->out + o->out_len, data, len);
+        o->out_len += len;
+    } else {
+        output_seal(o);
+        o->iov[o->iov_count].iov_base = (void*)data;
+        o->iov[o->iov_count].iov_len = len;
+        o->iov_count++;
+    }
+    return 0;
+}
+
+// 블록 단위로 읽어서 memchr 로 줄 시작을 찾고 그 앞에 번호를 붙인다
+int cat_numbered(int in) {
+    static char block[CAT_NUMBER_BLOCK];
+    line_number number;
+    int at_line_start = 1;
+    
+    number_init(&number);
+    
+    for (;;) {
+        ssize_t n = read(in, block, sizeof(block));
+        if (n == 0) {
+            return 0;
+        }
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
         }
         
-        char c;
-        int line_number = 1;
-        int at_line_start = 1;
+        const char* p = block;
+        const char* end = block + n;
         
-        while ((c = fgetc(file)) != EOF) {
-            if (show_line_numbers && at_line_start) {
-                printf("%6d\t", line_number);
+        while (p < end) {
+            if (at_line_start) {
+                if (output_add(&output, number.text + number.start, CAT_NUMBER_WIDTH - number.start) != 0) {
+                    return -1;
+                }
+                number_next(&number);
                 at_line_start = 0;
             }
             
-            putchar(c);
-            
-            if (c == '\n') {
-                line_number++;
-                at_line_start = 1;
+            const char* newline = memchr(p, '\n', end - p);
+            const char* stop = newline ? newline + 1 : end;
+            if (output_add(&output, p, stop - p) != 0) {
+                return -1;
             }
+            at_line_start = newline != NULL;
+            p = stop;
         }
         
-        fclose(file);
+        // iovec 이 block 을 가리키고 있으므로 다음 read 전에 내보낸다
+        if (output_flush(&output) != 0) {
+            return -1;
+        }
     }
+}
+
+int cat_fd(int fd, int show_line_numbers) {
+    return show_line_numbers ? cat_numbered(fd) : copy_fd(fd, STDOUT_FILENO);
+}
+
+// -n 이 없으면 바이트를 사용자 공간을 거치지 않고 그대로 옮긴다
+int cat_files(int argc, char* argv[], int start_idx, int show_line_numbers) {
+    int status = 0;
     
-    return 0;
-} 
\ No newline at end of file
+    if (argc < start_idx + 1) {
+        if (cat_fd(STDIN_FILENO, show_line_numbers) != 0) {
+            perror("cat");
+            return 1;
+        }
+        return 0;
+    }
+    
+    for (int i = start_idx; i < argc; i++) {
+        int fd = open(argv[i], O_RDONLY);
+        if (fd < 0) {
+            perror("cat");
+            status = 1;
+            continue;
+        }
+        
+        if (same_as_output(fd)) {
+            fprintf(stderr, "cat: %s: 입력 파일이 출력 파일입니다\n", argv[i]);
+            status = 1;
+        } else if (cat_fd(fd, show_line_numbers) != 0) {
+            perror("cat");
+            status = 1;
+        }
+        close(fd);
+    }
+    
+    return status;
+}
+
+int main(int argc, char* argv[]) {
+    int show_line_numbers = 0;
+    int start_idx = 1;
+    
+    if (argc > 1 && strcmp(argv[1], "-n") == 0) {
+        show_line_numbers = 1;
+        start_idx = 2;
+    }
+    
+    return cat_files(argc, argv, start_idx, show_line_numbers);
+}
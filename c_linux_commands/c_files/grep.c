@@ -1,126 +1,2256 @@
+#define _GNU_SOURCE
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <ctype.h>
 #include <unistd.h>
+#include <fcntl.h>
 #include <regex.h>
+#include <pthread.h>
+#include <dirent.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
 
+#define READ_BLOCK_SIZE (1024 * 1024)     // 파이프/표준 입력 블록 크기
+#define REGEX_WINDOW_SIZE (1024 * 1024)   // regexec() 한 번에 넘기는 최대 범위
+#define DIRENT_BUF_SIZE (64 * 1024)       // getdents64() 버퍼 크기
+#define OUTPUT_BUDGET (64L * 1024 * 1024) // 출력 차례를 기다리며 메모리에 모아 둘 수 있는 총량
+#define OUTPUT_STREAM_BUFFER (64 * 1024)  // 작업자 출력 스트림의 stdio 버퍼 크기
+#define DFA_MAX_STATES 2048               // 스레드별 DFA 캐시 크기 (가득 차면 비움)
+#define DFA_SYMBOLS 258                   // 바이트 256개 + 줄 시작/끝
+#define DFA_BOL 256
+#define DFA_EOL 257
+#define NFA_MAX_STATES 65536
+#define REPEAT_MAX 255
+
+typedef struct {
+    char** patterns;     // -e/-f 로 여러 개 지정 가능
+    int pattern_count;
+    int ignore_case;     // -i 옵션
+    int fixed_string;    // -F 옵션
+    int extended;        // -E 옵션 (ERE)
+    int use_dfa;         // --dfa 옵션 (내장 DFA 엔진, ERE 문법)
+    int threads;         // -j 옵션 (기본값: CPU 개수)
+    int recursive;       // -r 옵션 (1: 심볼릭 링크 무시, 2: -R 심볼릭 링크 따라감)
+    int mode;            // 출력 방식 (-c, -l, -q)
+    long max_count;      // -m 옵션 (-1: 제한 없음)
+} grep_options;
+
+enum {
+    OUTPUT_LINES,        // 매칭된 줄 출력 (기본)
+    OUTPUT_COUNT,        // -c: 매칭된 줄 수만 출력
+    OUTPUT_FILES,        // -l: 매칭된 파일 이름만 출력
+    OUTPUT_QUIET         // -q: 아무것도 출력하지 않음
+};
+
+// ---------------------------------------------------------------------------
+// 내장 DFA 정규표현식 엔진 (--dfa)
+// 0530 강의 노트의 ERE 문법(앵커, 문자 클래스, 수량자, 그룹, 대체)을 Thompson NFA로
+// 바꾼 뒤, 검색하면서 필요한 DFA 상태만 만들어 캐시한다 (lazy DFA)
+// 바이트마다 표 조회 한 번이므로 입력 길이에 대해 항상 선형 시간이다
+// ---------------------------------------------------------------------------
+
+// 파싱 트리 노드 (realloc 때문에 포인터 대신 배열 인덱스로 연결)
+typedef enum {
+    RE_SET,                     // 문자 집합 하나 (문자, '.', [...])
+    RE_BOL,                     // ^
+    RE_EOL,                     // $
+    RE_EMPTY,                   // 빈 패턴
+    RE_CAT,                     // 연결
+    RE_ALT,                     // |
+    RE_REPEAT                   // *, +, ?, {n,m}
+} re_node_type;
+
+typedef struct {
+    re_node_type type;
+    int left, right;
+    int min, max;               // RE_REPEAT: max < 0 이면 무한
+    unsigned char bits[32];     // RE_SET: 256비트 문자 집합
+} re_node;
+
+typedef struct {
+    const char* p;
+    int ignore_case;
+    int error;
+    re_node* nodes;
+    int node_count;
+    int node_capacity;
+} re_parser;
+
+// NFA 상태: SPLIT을 제외하면 모두 기호 하나를 소비하거나(SET, BOL, EOL) 매치(MATCH)
+typedef enum {
+    NFA_SET,
+    NFA_BOL,
+    NFA_EOL,
+    NFA_SPLIT,
+    NFA_MATCH
+} nfa_type;
+
+typedef struct {
+    nfa_type type;
+    int out, out1;
+    unsigned char bits[32];
+} nfa_state;
+
+typedef struct {
+    nfa_state* states;
+    int count;
+    int capacity;
+    int start;
+} re_program;
+
+// 스레드별 DFA 캐시
+// 매처 자체는 읽기 전용으로 두고, 검색 중 만들어지는 DFA 상태는 스레드마다 따로 가진다
+typedef struct {
+    int* trans;                 // [상태 * DFA_SYMBOLS + 기호] -> 다음 상태 (-1: 아직 모름)
+    unsigned char* accept;
+    int** sets;                 // 각 DFA 상태가 나타내는 NFA 상태 집합 (정렬됨)
+    int* set_sizes;
+    int count;
+    int capacity;
+    int* table;                 // 집합 -> 상태 번호 + 1 (개방 주소 해시)
+    int table_size;
+    int line_start;             // BOL을 읽은 직후 상태
+    int* mark;                  // 엡실론 폐포 계산용
+    int generation;
+    int* stack;
+    int* list;
+    int list_count;
+    size_t filter_skipped;      // 접두 필터가 건너뛴 바이트 수
+    size_t filter_checked;      // 접두 필터 후보 줄로 DFA에 넘긴 바이트 수
+    int filter_off;             // 후보 줄이 너무 많으면 필터를 끈다
+} dfa_cache;
+
+int re_new_node(re_parser* ps, re_node_type type) {
+    if (ps->node_count == ps->node_capacity) {
+        int capacity = ps->node_capacity ? ps->node_capacity * 2 : 64;
+        re_node* temp = realloc(ps->nodes, sizeof(re_node) * (size_t)capacity);
+        if (!temp) {
+            ps->error = 1;
+            return -1;
+        }
+        ps->nodes = temp;
+        ps->node_capacity = capacity;
+    }
+    
+    re_node* node = &ps->nodes[ps->node_count];
+    memset(node, 0, sizeof(*node));
+    node->type = type;
+    node->left = node->right = -1;
+    return ps->node_count++;
+}
+
+int re_binary(re_parser* ps, re_node_type type, int left, int right) {
+    int n = re_new_node(ps, type);
+    if (n >= 0) {
+        ps->nodes[n].left = left;
+        ps->nodes[n].right = right;
+    }
+    return n;
+}
+
+void set_add(unsigned char* bits, int c) {
+    bits[c >> 3] |= (unsigned char)(1 << (c & 7));
+}
+
+int set_has(const unsigned char* bits, int c) {
+    return (bits[c >> 3] >> (c & 7)) & 1;
+}
+
+// -i 는 컴파일할 때 집합에 대소문자를 모두 넣어 처리한다
+void re_fold_set(unsigned char* bits) {
+    for (int c = 0; c < 256; c++) {
+        if (set_has(bits, c)) {
+            set_add(bits, tolower(c));
+            set_add(bits, toupper(c));
+        }
+    }
+}
+
+int re_raw_set_node(re_parser* ps, const unsigned char* bits) {
+    int n = re_new_node(ps, RE_SET);
+    if (n >= 0) {
+        memcpy(ps->nodes[n].bits, bits, 32);
+    }
+    return n;
+}
+
+int re_set_node(re_parser* ps, unsigned char* bits) {
+    if (ps->ignore_case) {
+        re_fold_set(bits);
+    }
+    return re_raw_set_node(ps, bits);
+}
+
+// [:alpha:] 같은 POSIX 문자 클래스
+int re_parse_class_name(re_parser* ps, unsigned char* bits) {
+    static const struct {
+        const char* name;
+        int (*test)(int);
+    } classes[] = {
+        { "alpha", isalpha }, { "digit", isdigit }, { "alnum", isalnum },
+        { "upper", isupper }, { "lower", islower }, { "space", isspace },
+        { "blank", isblank }, { "punct", ispunct }, { "print", isprint },
+        { "graph", isgraph }, { "cntrl", iscntrl }, { "xdigit", isxdigit },
+    };
+    
+    const char* end = strstr(ps->p, ":]");
+    if (!end) {
+        return -1;
+    }
+    
+    size_t len = (size_t)(end - ps->p);
+    for (size_t i = 0; i < sizeof(classes) / sizeof(classes[0]); i++) {
+        if (strlen(classes[i].name) == len && strncmp(ps->p, classes[i].name, len) == 0) {
+            for (int c = 0; c < 256; c++) {
+                if (classes[i].test(c)) {
+                    set_add(bits, c);
+                }
+            }
+            ps->p = end + 2;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+// '[' 다음부터 ']'까지
+int re_parse_bracket(re_parser* ps) {
+    unsigned char bits[32] = {0};
+    int negate = 0;
+    
+    if (*ps->p == '^') {
+        negate = 1;
+        ps->p++;
+    }
+    
+    // 맨 앞의 ']'는 일반 문자
+    int first = 1;
+    while (*ps->p && (*ps->p != ']' || first)) {
+        first = 0;
+        
+        if (ps->p[0] == '[' && ps->p[1] == ':') {
+            ps->p += 2;
+            if (re_parse_class_name(ps, bits) != 0) {
+                ps->error = 1;
+                return -1;
+            }
+            continue;
+        }
+        
+        // [=a=], [.a.] 같은 동치/대조 클래스는 지원하지 않는다
+        if (ps->p[0] == '[' && (ps->p[1] == '=' || ps->p[1] == '.')) {
+            ps->error = 1;
+            return -1;
+        }
+        
+        unsigned char lo = (unsigned char)*ps->p++;
+        unsigned char hi = lo;
+        if (ps->p[0] == '-' && ps->p[1] && ps->p[1] != ']') {
+            hi = (unsigned char)ps->p[1];
+            ps->p += 2;
+            if (hi < lo) {
+                ps->error = 1;
+                return -1;
+            }
+        }
+        for (int c = lo; c <= hi; c++) {
+            set_add(bits, c);
+        }
+    }
+    
+    if (*ps->p != ']') {
+        ps->error = 1;
+        return -1;
+    }
+    ps->p++;
+    
+    // 대소문자 무시는 부정하기 전에 적용해야 [^a] 가 'A'와도 일치하지 않는다
+    if (ps->ignore_case) {
+        re_fold_set(bits);
+    }
+    
+    if (negate) {
+        for (int i = 0; i < 32; i++) {
+            bits[i] = (unsigned char)~bits[i];
+        }
+        // 부정 집합도 개행 문자와는 일치하지 않는다
+        bits['\n' >> 3] &= (unsigned char)~(1 << ('\n' & 7));
+    }
+    
+    return re_raw_set_node(ps, bits);
+}
+
+int re_parse_alt(re_parser* ps);
+
+int re_parse_atom(re_parser* ps) {
+    unsigned char bits[32] = {0};
+    char c = *ps->p++;
+    
+    switch (c) {
+    case '(': {
+        int inner = re_parse_alt(ps);
+        if (*ps->p != ')') {
+            ps->error = 1;
+            return -1;
+        }
+        ps->p++;
+        return inner;
+    }
+    case '[':
+        return re_parse_bracket(ps);
+    case '.':
+        memset(bits, 0xff, sizeof(bits));
+        bits['\n' >> 3] &= (unsigned char)~(1 << ('\n' & 7));
+        return re_set_node(ps, bits);
+    case '^':
+        return re_new_node(ps, RE_BOL);
+    case '$':
+        return re_new_node(ps, RE_EOL);
+    case '\\':
+        c = *ps->p++;
+        switch (c) {
+        case '\0':
+            ps->error = 1;
+            return -1;
+        case 'w':
+        case 'W':
+        case 's':
+        case 'S':
+            for (int ch = 0; ch < 256; ch++) {
+                // isspace() 는 1 이 아닌 0 아닌 값을 돌려줄 수 있으므로 0/1 로 맞춘다
+                int in = (c == 'w' || c == 'W') ? !!(isalnum(ch) || ch == '_') : !!isspace(ch);
+                if (in == (c == 'w' || c == 's')) {
+                    set_add(bits, ch);
+                }
+            }
+            return re_set_node(ps, bits);
+        default:
+            // 역참조(\1)와 단어 경계(\b, \<, \>)는 DFA로 표현할 수 없다
+            if (isalnum((unsigned char)c) || c == '<' || c == '>') {
+                ps->error = 1;
+                return -1;
+            }
+            // 이스케이프된 메타 문자는 일반 문자
+            set_add(bits, (unsigned char)c);
+            return re_set_node(ps, bits);
+        }
+    default:
+        set_add(bits, (unsigned char)c);
+        return re_set_node(ps, bits);
+    }
+}
+
+// {n}, {n,}, {n,m}, {,m}: 형식이 맞지 않으면 0을 돌려주고 '{'를 일반 문자로 둔다
+int re_parse_bound(re_parser* ps, int* min, int* max) {
+    const char* p = ps->p + 1;
+    char* end;
+    
+    *min = 0;
+    *max = -1;
+    if (isdigit((unsigned char)*p)) {
+        *min = (int)strtol(p, &end, 10);
+        p = end;
+    } else if (*p != ',') {
+        return 0;
+    }
+    
+    if (*p == ',') {
+        p++;
+        if (isdigit((unsigned char)*p)) {
+            *max = (int)strtol(p, &end, 10);
+            p = end;
+        }
+    } else {
+        *max = *min;
+    }
+    
+    if (*p != '}' || (*max >= 0 && *max < *min)) {
+        return 0;
+    }
+    
+    ps->p = p + 1;
+    return 1;
+}
+
+int re_parse_repeat(re_parser* ps) {
+    int atom = re_parse_atom(ps);
+    
+    while (atom >= 0) {
+        int min, max;
+        
+        if (*ps->p == '*') {
+            min = 0;
+            max = -1;
+            ps->p++;
+        } else if (*ps->p == '+') {
+            min = 1;
+            max = -1;
+            ps->p++;
+        } else if (*ps->p == '?') {
+            min = 0;
+            max = 1;
+            ps->p++;
+        } else if (*ps->p == '{' && re_parse_bound(ps, &min, &max)) {
+            // 반복 횟수만큼 NFA를 펼치므로 너무 큰 반복은 지원하지 않는다
+            if (min > REPEAT_MAX || max > REPEAT_MAX) {
+                ps->error = 1;
+                return -1;
+            }
+        } else {
+            break;
+        }
+        
+        int n = re_new_node(ps, RE_REPEAT);
+        if (n < 0) {
+            return -1;
+        }
+        ps->nodes[n].left = atom;
+        ps->nodes[n].min = min;
+        ps->nodes[n].max = max;
+        atom = n;
+    }
+    
+    return atom;
+}
+
+int re_parse_cat(re_parser* ps) {
+    int result = -1;
+    
+    while (!ps->error && *ps->p && *ps->p != '|' && *ps->p != ')') {
+        int n;
+        
+        // 앞에 올 대상이 없는 수량자는 일반 문자로 취급
+        if (*ps->p == '*' || *ps->p == '+' || *ps->p == '?') {
+            unsigned char bits[32] = {0};
+            set_add(bits, (unsigned char)*ps->p++);
+            n = re_set_node(ps, bits);
+        } else {
+            n = re_parse_repeat(ps);
+        }
+        
+        if (n < 0) {
+            ps->error = 1;
+            return -1;
+        }
+        result = result < 0 ? n : re_binary(ps, RE_CAT, result, n);
+    }
+    
+    return result < 0 ? re_new_node(ps, RE_EMPTY) : result;
+}
+
+int re_parse_alt(re_parser* ps) {
+    int result = re_parse_cat(ps);
+    
+    while (!ps->error && *ps->p == '|') {
+        ps->p++;
+        int right = re_parse_cat(ps);
+        result = re_binary(ps, RE_ALT, result, right);
+    }
+    
+    return ps->error ? -1 : result;
+}
+
+int nfa_new(re_program* prog, nfa_type type, int out) {
+    if (prog->count == prog->capacity) {
+        if (prog->capacity >= NFA_MAX_STATES) {
+            return -1;
+        }
+        int capacity = prog->capacity ? prog->capacity * 2 : 64;
+        nfa_state* temp = realloc(prog->states, sizeof(nfa_state) * (size_t)capacity);
+        if (!temp) {
+            return -1;
+        }
+        prog->states = temp;
+        prog->capacity = capacity;
+    }
+    
+    nfa_state* s = &prog->states[prog->count];
+    memset(s, 0, sizeof(*s));
+    s->type = type;
+    s->out = out;
+    s->out1 = -1;
+    return prog->count++;
+}
+
+// 노드를 NFA로 바꾼다: 매치가 끝나면 next 상태로 이어지고, 시작 상태를 돌려준다
+// 뒤에서부터 만들기 때문에 미완성 연결(patch list)을 관리할 필요가 없다
+int nfa_compile(re_program* prog, const re_parser* ps, int node, int next) {
+    const re_node* n = &ps->nodes[node];
+    int s, a;
+    
+    if (next < 0) {
+        return -1;
+    }
+    
+    switch (n->type) {
+    case RE_SET:
+        s = nfa_new(prog, NFA_SET, next);
+        if (s >= 0) {
+            memcpy(prog->states[s].bits, n->bits, 32);
+        }
+        return s;
+    case RE_BOL:
+        return nfa_new(prog, NFA_BOL, next);
+    case RE_EOL:
+        return nfa_new(prog, NFA_EOL, next);
+    case RE_EMPTY:
+        return next;
+    case RE_CAT:
+        return nfa_compile(prog, ps, n->left, nfa_compile(prog, ps, n->right, next));
+    case RE_ALT:
+        s = nfa_new(prog, NFA_SPLIT, -1);
+        if (s < 0) {
+            return -1;
+        }
+        a = nfa_compile(prog, ps, n->left, next);
+        prog->states[s].out = a;
+        prog->states[s].out1 = nfa_compile(prog, ps, n->right, next);
+        return (a < 0 || prog->states[s].out1 < 0) ? -1 : s;
+    case RE_REPEAT: {
+        int cur = next;
+        
+        if (n->max < 0) {
+            // x{min,} = x...x x*
+            s = nfa_new(prog, NFA_SPLIT, -1);
+            if (s < 0) {
+                return -1;
+            }
+            prog->states[s].out1 = next;
+            a = nfa_compile(prog, ps, n->left, s);
+            prog->states[s].out = a;
+            cur = a < 0 ? -1 : s;
+        } else {
+            // 선택적인 (max - min) 개: 각각 건너뛰면 바로 next로
+            for (int i = 0; i < n->max - n->min && cur >= 0; i++) {
+                s = nfa_new(prog, NFA_SPLIT, -1);
+                if (s < 0) {
+                    return -1;
+                }
+                a = nfa_compile(prog, ps, n->left, cur);
+                prog->states[s].out = a;
+                prog->states[s].out1 = next;
+                cur = a < 0 ? -1 : s;
+            }
+        }
+        
+        for (int i = 0; i < n->min && cur >= 0; i++) {
+            cur = nfa_compile(prog, ps, n->left, cur);
+        }
+        return cur;
+    }
+    }
+    
+    return -1;
+}
+
+// 매치마다 반드시 나타나는 고정 문자열 후보를 모아 가장 긴 것을 고른다 (memchr 접두 필터용)
+typedef struct {
+    char best[256];
+    size_t best_len;
+    char run[256];
+    size_t run_len;
+} re_literal;
+
+void re_literal_end_run(re_literal* lit) {
+    if (lit->run_len > lit->best_len) {
+        memcpy(lit->best, lit->run, lit->run_len);
+        lit->best_len = lit->run_len;
+    }
+    lit->run_len = 0;
+}
+
+// 집합이 (대소문자를 무시하면) 문자 하나뿐이면 그 문자, 아니면 -1
+int re_single_char(const re_parser* ps, const re_node* n) {
+    int found = -1;
+    
+    for (int c = 0; c < 256; c++) {
+        if (!set_has(n->bits, c)) {
+            continue;
+        }
+        int key = ps->ignore_case ? tolower(c) : c;
+        if (found >= 0 && found != key) {
+            return -1;
+        }
+        found = key;
+    }
+    return found;
+}
+
+void re_collect_literal(const re_parser* ps, int node, re_literal* lit) {
+    const re_node* n = &ps->nodes[node];
+    int c;
+    
+    switch (n->type) {
+    case RE_SET:
+        c = re_single_char(ps, n);
+        if (c < 0) {
+            re_literal_end_run(lit);
+        } else if (lit->run_len < sizeof(lit->run)) {
+            lit->run[lit->run_len++] = (char)c;
+        }
+        break;
+    case RE_BOL:
+    case RE_EOL:
+    case RE_EMPTY:
+        // 폭이 0이므로 앞뒤 문자가 그대로 이어진다
+        break;
+    case RE_CAT:
+        re_collect_literal(ps, n->left, lit);
+        re_collect_literal(ps, n->right, lit);
+        break;
+    case RE_ALT:
+        re_literal_end_run(lit);
+        break;
+    case RE_REPEAT:
+        // 최소 한 번 나오는 부분은 그 안의 문자열도 반드시 나타난다
+        re_literal_end_run(lit);
+        if (n->min >= 1) {
+            re_collect_literal(ps, n->left, lit);
+            re_literal_end_run(lit);
+        }
+        break;
+    }
+}
+
+void dfa_cache_free(void* arg) {
+    dfa_cache* c = arg;
+    
+    if (!c) {
+        return;
+    }
+    for (int i = 0; i < c->count; i++) {
+        free(c->sets[i]);
+    }
+    free(c->trans);
+    free(c->accept);
+    free(c->sets);
+    free(c->set_sizes);
+    free(c->table);
+    free(c->mark);
+    free(c->stack);
+    free(c->list);
+    free(c);
+}
+
+void dfa_cache_reset(dfa_cache* c) {
+    for (int i = 0; i < c->count; i++) {
+        free(c->sets[i]);
+    }
+    c->count = 0;
+    memset(c->table, 0, sizeof(int) * (size_t)c->table_size);
+}
+
+// NFA 상태 s에서 엡실론(SPLIT)으로 갈 수 있는 상태를 c->list에 모은다
+void dfa_closure(const re_program* prog, dfa_cache* c, int s) {
+    int top = 0;
+    
+    c->stack[top++] = s;
+    while (top > 0) {
+        s = c->stack[--top];
+        if (s < 0 || c->mark[s] == c->generation) {
+            continue;
+        }
+        c->mark[s] = c->generation;
+        
+        if (prog->states[s].type == NFA_SPLIT) {
+            c->stack[top++] = prog->states[s].out1;
+            c->stack[top++] = prog->states[s].out;
+        } else {
+            c->list[c->list_count++] = s;
+        }
+    }
+}
+
+int compare_int(const void* a, const void* b) {
+    int x = *(const int*)a, y = *(const int*)b;
+    return (x > y) - (x < y);
+}
+
+// c->list 의 NFA 상태 집합에 해당하는 DFA 상태 번호 (없으면 새로 만든다)
+int dfa_intern(const re_program* prog, dfa_cache* c) {
+    qsort(c->list, (size_t)c->list_count, sizeof(int), compare_int);
+    
+    unsigned int hash = 2166136261u;
+    for (int i = 0; i < c->list_count; i++) {
+        hash = (hash ^ (unsigned int)c->list[i]) * 16777619u;
+    }
+    
+    unsigned int slot = hash & (unsigned int)(c->table_size - 1);
+    while (c->table[slot]) {
+        int d = c->table[slot] - 1;
+        if (c->set_sizes[d] == c->list_count &&
+            memcmp(c->sets[d], c->list, sizeof(int) * (size_t)c->list_count) == 0) {
+            return d;
+        }
+        slot = (slot + 1) & (unsigned int)(c->table_size - 1);
+    }
+    
+    int d = c->count;
+    int* set = malloc(sizeof(int) * (size_t)(c->list_count ? c->list_count : 1));
+    if (!set) {
+        return -1;
+    }
+    memcpy(set, c->list, sizeof(int) * (size_t)c->list_count);
+    
+    c->sets[d] = set;
+    c->set_sizes[d] = c->list_count;
+    c->accept[d] = 0;
+    for (int i = 0; i < c->list_count; i++) {
+        if (prog->states[c->list[i]].type == NFA_MATCH) {
+            c->accept[d] = 1;
+        }
+    }
+    for (int i = 0; i < DFA_SYMBOLS; i++) {
+        c->trans[(size_t)d * DFA_SYMBOLS + i] = -1;
+    }
+    c->table[slot] = d + 1;
+    c->count++;
+    return d;
+}
+
+// 시작 상태(0)와 줄 시작 상태를 만든다
+int dfa_cache_init_states(const re_program* prog, dfa_cache* c) {
+    c->generation++;
+    c->list_count = 0;
+    dfa_closure(prog, c, prog->start);
+    if (dfa_intern(prog, c) != 0) {
+        return -1;
+    }
+    
+    c->generation++;
+    c->list_count = 0;
+    for (int i = 0; i < c->set_sizes[0]; i++) {
+        const nfa_state* s = &prog->states[c->sets[0][i]];
+        if (s->type == NFA_BOL) {
+            dfa_closure(prog, c, s->out);
+        }
+    }
+    dfa_closure(prog, c, prog->start);
+    c->line_start = dfa_intern(prog, c);
+    if (c->line_start < 0) {
+        return -1;
+    }
+    c->trans[DFA_BOL] = c->line_start;
+    return 0;
+}
+
+dfa_cache* dfa_cache_new(const re_program* prog) {
+    dfa_cache* c = calloc(1, sizeof(dfa_cache));
+    if (!c) {
+        return NULL;
+    }
+    
+    c->capacity = DFA_MAX_STATES;
+    c->table_size = DFA_MAX_STATES * 2;
+    c->trans = malloc(sizeof(int) * DFA_SYMBOLS * (size_t)c->capacity);
+    c->accept = malloc((size_t)c->capacity);
+    c->sets = malloc(sizeof(int*) * (size_t)c->capacity);
+    c->set_sizes = malloc(sizeof(int) * (size_t)c->capacity);
+    c->table = calloc((size_t)c->table_size, sizeof(int));
+    c->mark = calloc((size_t)prog->count, sizeof(int));
+    c->stack = malloc(sizeof(int) * (size_t)prog->count * 2 + sizeof(int));
+    c->list = malloc(sizeof(int) * (size_t)prog->count);
+    
+    if (!c->trans || !c->accept || !c->sets || !c->set_sizes || !c->table ||
+        !c->mark || !c->stack || !c->list || dfa_cache_init_states(prog, c) != 0) {
+        dfa_cache_free(c);
+        return NULL;
+    }
+    return c;
+}
+
+// 아직 계산하지 않은 전이를 계산한다
+// 캐시가 가득 차면 비우고 다시 시작하므로 메모리는 DFA_MAX_STATES 로 제한된다
+int dfa_step(const re_program* prog, dfa_cache* c, int state, int sym) {
+    c->generation++;
+    c->list_count = 0;
+    
+    for (int i = 0; i < c->set_sizes[state]; i++) {
+        const nfa_state* s = &prog->states[c->sets[state][i]];
+        if ((s->type == NFA_SET && sym < 256 && set_has(s->bits, sym)) ||
+            (s->type == NFA_BOL && sym == DFA_BOL) ||
+            (s->type == NFA_EOL && sym == DFA_EOL)) {
+            dfa_closure(prog, c, s->out);
+        }
+    }
+    
+    // 어느 위치에서든 매치가 시작될 수 있으므로 시작 상태를 항상 다시 넣는다
+    dfa_closure(prog, c, prog->start);
+    
+    if (c->count == c->capacity) {
+        // 새 집합은 c->list 에 남아 있으므로 초기 상태를 다시 만든 뒤 등록한다
+        int* saved = malloc(sizeof(int) * (size_t)(c->list_count ? c->list_count : 1));
+        int saved_count = c->list_count;
+        if (!saved) {
+            return -1;
+        }
+        memcpy(saved, c->list, sizeof(int) * (size_t)saved_count);
+        
+        dfa_cache_reset(c);
+        if (dfa_cache_init_states(prog, c) != 0) {
+            free(saved);
+            return -1;
+        }
+        memcpy(c->list, saved, sizeof(int) * (size_t)saved_count);
+        c->list_count = saved_count;
+        free(saved);
+        return dfa_intern(prog, c);
+    }
+    
+    int next = dfa_intern(prog, c);
+    if (next >= 0) {
+        c->trans[(size_t)state * DFA_SYMBOLS + sym] = next;
+    }
+    return next;
+}
+
+typedef enum {
+    MATCHER_LITERAL,            // 고정 문자열 하나
+    MATCHER_AHO_CORASICK,       // 고정 문자열 여러 개
+    MATCHER_REGEX,              // 정규표현식 (여러 개면 가장 앞선 매치)
+    MATCHER_DFA                 // 내장 DFA 엔진 (여러 개면 대체(|)로 묶음)
+} matcher_kind;
+
+// main()에서 한 번만 컴파일해 모든 파일이 공유하는 매처
+// 컴파일 후에는 읽기 전용이므로 여러 스레드에서 동시에 사용해도 안전하다
+typedef struct {
+    matcher_kind kind;
+    int ignore_case;
+    int match_all;              // 빈 패턴이 있으면 모든 줄이 매칭된다
+    unsigned char fold[256];    // -i 용 소문자 변환 테이블
+    
+    // MATCHER_LITERAL (MATCHER_DFA 의 접두 필터도 같은 필드를 쓴다)
+    const char* lit;
+    size_t lit_len;
+    size_t skip[256];           // Boyer-Moore-Horspool 이동 거리 테이블
+    
+    // MATCHER_AHO_CORASICK: 바이트를 문자 클래스로 줄인 완전 DFA
+    unsigned short ac_class[256];   // 바이트 256개가 모두 쓰이면 클래스는 257개까지
+    int ac_classes;
+    int* ac_next;               // [상태 * ac_classes + 클래스] -> 다음 상태
+    unsigned char* ac_output;   // 상태에서 끝나는 패턴이 있으면 1
+    
+    // MATCHER_REGEX
+    regex_t* regexes;
+    int regex_count;
+    
+    // MATCHER_DFA
+    re_program program;
+    char* dfa_literal;          // 모든 매치에 들어 있는 고정 문자열 (없으면 NULL)
+    pthread_key_t dfa_key;      // 스레드별 dfa_cache
+} grep_matcher;
+
+// 메타 문자가 하나도 없으면 고정 문자열로 취급할 수 있다
+int is_literal_pattern(const char* pattern, int extended) {
+    return strpbrk(pattern, extended ? ".[]*^$\\+?(){}|" : ".[]*^$\\") == NULL;
+}
+
+// 고정 문자열 검색: 대소문자를 구분하면 memmem(), 무시하면 BMH
+const char* literal_find(const grep_matcher* m, const char* buf, size_t len) {
+    if (m->lit_len == 0) {
+        return buf;
+    }
+    
+    if (!m->ignore_case) {
+        return memmem(buf, len, m->lit, m->lit_len);
+    }
+    
+    const unsigned char* text = (const unsigned char*)buf;
+    const unsigned char* pat = (const unsigned char*)m->lit;
+    size_t last = m->lit_len - 1;
+    size_t pos = 0;
+    
+    while (pos + last < len) {
+        unsigned char c = m->fold[text[pos + last]];
+        if (c == m->fold[pat[last]]) {
+            size_t i = 0;
+            while (i < last && m->fold[text[pos + i]] == m->fold[pat[i]]) {
+                i++;
+            }
+            if (i == last) {
+                return buf + pos;
+            }
+        }
+        pos += m->skip[c];
+    }
+    
+    return NULL;
+}
+
+// 패턴 집합 전체를 한 번의 통과로 찾는 Aho-Corasick 오토마톤을 만든다
+// 실패 링크를 미리 따라가 둔 완전 DFA이므로 검색 중에는 바이트당 표 조회 한 번이다
+int ac_build(grep_matcher* m, char** patterns, int count) {
+    size_t total = 1;
+    
+    // 패턴에 나오는 바이트마다 클래스 번호를 매기고, 나머지는 모두 클래스 0
+    memset(m->ac_class, 0, sizeof(m->ac_class));
+    m->ac_classes = 1;
+    for (int i = 0; i < count; i++) {
+        for (const unsigned char* p = (const unsigned char*)patterns[i]; *p; p++) {
+            unsigned char c = m->fold[*p];
+            if (m->ac_class[c] == 0) {
+                m->ac_class[c] = (unsigned short)m->ac_classes++;
+            }
+            total++;
+        }
+    }
+    for (int c = 0; c < 256; c++) {
+        m->ac_class[c] = m->ac_class[m->fold[c]];
+    }
+    
+    int k = m->ac_classes;
+    m->ac_next = malloc(sizeof(int) * total * (size_t)k);
+    m->ac_output = calloc(total, 1);
+    int* fail = malloc(sizeof(int) * total);
+    int* queue = malloc(sizeof(int) * total);
+    if (!m->ac_next || !m->ac_output || !fail || !queue) {
+        free(fail);
+        free(queue);
+        return -1;
+    }
+    memset(m->ac_next, -1, sizeof(int) * total * (size_t)k);
+    
+    // 1단계: 트라이 구성
+    int states = 1;
+    for (int i = 0; i < count; i++) {
+        int state = 0;
+        for (const unsigned char* p = (const unsigned char*)patterns[i]; *p; p++) {
+            int* slot = &m->ac_next[state * k + m->ac_class[*p]];
+            if (*slot < 0) {
+                *slot = states++;
+            }
+            state = *slot;
+        }
+        m->ac_output[state] = 1;
+    }
+    
+    // 2단계: BFS로 실패 링크를 계산하면서 빠진 전이를 채운다
+    int head = 0, tail = 0;
+    for (int c = 0; c < k; c++) {
+        int* slot = &m->ac_next[c];
+        if (*slot < 0) {
+            *slot = 0;
+        } else {
+            fail[*slot] = 0;
+            queue[tail++] = *slot;
+        }
+    }
+    while (head < tail) {
+        int state = queue[head++];
+        m->ac_output[state] |= m->ac_output[fail[state]];
+        
+        for (int c = 0; c < k; c++) {
+            int* slot = &m->ac_next[state * k + c];
+            int via_fail = m->ac_next[fail[state] * k + c];
+            if (*slot < 0) {
+                *slot = via_fail;
+            } else {
+                fail[*slot] = via_fail;
+                queue[tail++] = *slot;
+            }
+        }
+    }
+    
+    free(fail);
+    free(queue);
+    return 0;
+}
+
+// 오토마톤이 출력 상태에 도달한 위치(매치의 마지막 바이트)를 돌려준다
+const char* ac_find(const grep_matcher* m, const char* buf, size_t len) {
+    const unsigned char* text = (const unsigned char*)buf;
+    const int* next = m->ac_next;
+    int k = m->ac_classes;
+    int state = 0;
+    
+    for (size_t i = 0; i < len; i++) {
+        state = next[state * k + m->ac_class[text[i]]];
+        if (m->ac_output[state]) {
+            return buf + i;
+        }
+    }
+    
+    return NULL;
+}
+
+dfa_cache* dfa_get_cache(const grep_matcher* m) {
+    dfa_cache* c = pthread_getspecific(m->dfa_key);
+    
+    if (!c) {
+        c = dfa_cache_new(&m->program);
+        if (c) {
+            pthread_setspecific(m->dfa_key, c);
+        }
+    }
+    return c;
+}
+
+// buf 는 줄의 시작이어야 한다, 매치가 끝난 위치(또는 그 줄의 개행 문자)를 돌려준다
+const char* dfa_find(const grep_matcher* m, const char* buf, size_t len) {
+    const unsigned char* text = (const unsigned char*)buf;
+    dfa_cache* c = dfa_get_cache(m);
+    
+    if (!c) {
+        fprintf(stderr, "grep: 메모리 할당 실패\n");
+        return NULL;
+    }
+    
+    const int* trans = c->trans;
+    const unsigned char* accept = c->accept;
+    int state = c->line_start;
+    
+    if (accept[state]) {
+        return buf;
+    }
+    
+    for (size_t i = 0; i <= len; i++) {
+        int sym;
+        if (i == len) {
+            // 개행 문자 없이 끝나는 마지막 줄
+            if (len == 0 || text[len - 1] == '\n') {
+                break;
+            }
+            sym = DFA_EOL;
+        } else {
+            sym = text[i] == '\n' ? DFA_EOL : text[i];
+        }
+        
+        int next = trans[(size_t)state * DFA_SYMBOLS + sym];
+        if (next < 0) {
+            next = dfa_step(&m->program, c, state, sym);
+            if (next < 0) {
+                fprintf(stderr, "grep: 메모리 할당 실패\n");
+                return NULL;
+            }
+        }
+        if (accept[next]) {
+            return buf + i;
+        }
+        
+        // 줄이 끝나면 다음 줄은 다시 줄 시작 상태에서
+        state = sym == DFA_EOL ? c->line_start : next;
+    }
+    
+    return NULL;
+}
+
+// 접두 필터가 건너뛴 양보다 후보 줄이 더 많으면 이 스레드에서는 필터를 끈다
+int dfa_filter_off(const grep_matcher* m) {
+    dfa_cache* c = dfa_get_cache(m);
+    
+    if (c && !c->filter_off && c->filter_checked > (1 << 20) &&
+        c->filter_checked > c->filter_skipped) {
+        c->filter_off = 1;
+    }
+    return c ? c->filter_off : 0;
+}
+
+// 패턴 목록을 파싱해 NFA를 만든다, 지원하지 않는 문법이면 -1 (regcomp()로 대체)
+int dfa_compile(grep_matcher* m, const grep_options* opts) {
+    re_parser ps = {0};
+    int root = -1;
+    
+    ps.ignore_case = opts->ignore_case;
+    for (int i = 0; i < opts->pattern_count && !ps.error; i++) {
+        ps.p = opts->patterns[i];
+        int n = re_parse_alt(&ps);
+        if (*ps.p != '\0') {
+            ps.error = 1;   // 짝이 맞지 않는 ')'
+        }
+        root = root < 0 ? n : re_binary(&ps, RE_ALT, root, n);
+    }
+    
+    if (ps.error || root < 0) {
+        free(ps.nodes);
+        return -1;
+    }
+    
+    int match = nfa_new(&m->program, NFA_MATCH, -1);
+    m->program.start = match < 0 ? -1 : nfa_compile(&m->program, &ps, root, match);
+    if (m->program.start < 0) {
+        free(ps.nodes);
+        free(m->program.states);
+        memset(&m->program, 0, sizeof(m->program));
+        return -1;
+    }
+    
+    // 반드시 나와야 하는 고정 문자열이 있으면 그것으로 후보 줄을 먼저 거른다
+    re_literal lit = {0};
+    re_collect_literal(&ps, root, &lit);
+    re_literal_end_run(&lit);
+    free(ps.nodes);
+    
+    if (lit.best_len > 0) {
+        m->dfa_literal = strndup(lit.best, lit.best_len);
+        if (m->dfa_literal) {
+            m->lit = m->dfa_literal;
+            m->lit_len = lit.best_len;
+            for (int c = 0; c < 256; c++) {
+                m->skip[c] = m->lit_len;
+            }
+            for (size_t i = 0; i + 1 < m->lit_len; i++) {
+                m->skip[m->fold[(unsigned char)m->lit[i]]] = m->lit_len - 1 - i;
+            }
+        }
+    }
+    
+    if (pthread_key_create(&m->dfa_key, dfa_cache_free) != 0) {
+        return -1;
+    }
+    m->kind = MATCHER_DFA;
+    return 0;
+}
+
+int matcher_compile(grep_matcher* m, const grep_options* opts) {
+    int literal = 1;
+    
+    memset(m, 0, sizeof(*m));
+    m->ignore_case = opts->ignore_case;
+    for (int c = 0; c < 256; c++) {
+        m->fold[c] = opts->ignore_case ? (unsigned char)tolower(c) : (unsigned char)c;
+    }
+    
+    for (int i = 0; i < opts->pattern_count; i++) {
+        if (!opts->fixed_string && !is_literal_pattern(opts->patterns[i], opts->extended)) {
+            literal = 0;
+        }
+        if (opts->patterns[i][0] == '\0') {
+            m->match_all = 1;
+        }
+    }
+    
+    if (literal && opts->pattern_count == 1) {
+        m->kind = MATCHER_LITERAL;
+        m->lit = opts->patterns[0];
+        m->lit_len = strlen(opts->patterns[0]);
+        
+        for (int c = 0; c < 256; c++) {
+            m->skip[c] = m->lit_len;
+        }
+        
+        // 마지막 문자를 제외한 각 문자가 패턴 끝에서 얼마나 떨어져 있는지 기록
+        for (size_t i = 0; i + 1 < m->lit_len; i++) {
+            m->skip[m->fold[(unsigned char)m->lit[i]]] = m->lit_len - 1 - i;
+        }
+        
+        return 0;
+    }
+    
+    if (literal) {
+        m->kind = MATCHER_AHO_CORASICK;
+        if (ac_build(m, opts->patterns, opts->pattern_count) != 0) {
+            fprintf(stderr, "grep: 메모리 할당 실패\n");
+            return -1;
+        }
+        return 0;
+    }
+    
+    // 내장 엔진이 처리할 수 없는 패턴(역참조 등)은 regexec()로 검색한다
+    if (opts->use_dfa && dfa_compile(m, opts) == 0) {
+        return 0;
+    }
+    
+    m->kind = MATCHER_REGEX;
+    m->regexes = malloc(sizeof(regex_t) * (size_t)opts->pattern_count);
+    if (!m->regexes) {
+        fprintf(stderr, "grep: 메모리 할당 실패\n");
+        return -1;
+    }
+    
+    // 버퍼 전체를 한 번에 검사하므로 '.'과 '^', '$'가 줄 경계를 넘지 않게 한다
+    int regex_flags = REG_NEWLINE;
+    
+    if (opts->extended) {
+        regex_flags |= REG_EXTENDED;
+    }
+    
+    // 대소문자 무시 옵션 설정
+    if (opts->ignore_case) {
+        regex_flags |= REG_ICASE;
+    }
+    
+    // 정규표현식 컴파일
+    for (int i = 0; i < opts->pattern_count; i++) {
+        int ret = regcomp(&m->regexes[i], opts->patterns[i], regex_flags);
+        if (ret != 0) {
+            char error_msg[256];
+            regerror(ret, &m->regexes[i], error_msg, sizeof(error_msg));
+            fprintf(stderr, "grep: 잘못된 정규표현식: %s\n", error_msg);
+            return -1;
+        }
+        m->regex_count++;
+    }
+    
+    return 0;
+}
+
+void matcher_free(grep_matcher* m) {
+    for (int i = 0; i < m->regex_count; i++) {
+        regfree(&m->regexes[i]);
+    }
+    free(m->regexes);
+    free(m->ac_next);
+    free(m->ac_output);
+    
+    if (m->kind == MATCHER_DFA) {
+        dfa_cache_free(pthread_getspecific(m->dfa_key));
+        pthread_key_delete(m->dfa_key);
+        free(m->program.states);
+        free(m->dfa_literal);
+    }
+}
+
+// 여러 정규표현식 중 가장 앞선 매치를 찾는다
+// 앞에서 찾은 매치가 있으면 그 줄 끝까지만 나머지 패턴을 검사한다
+// REG_NEWLINE 이 있어도 [[:space:]] 나 \s 는 '\n' 과 맞을 수 있으므로, 매치가 줄을 넘으면
+// 그 줄만 다시 검사하고 거기서도 없으면 다음 줄부터 이어서 찾는다
+const char* regex_find(const grep_matcher* m, const char* buf, size_t len) {
+    size_t limit = len;
+    const char* best = NULL;
+    
+    for (int i = 0; i < m->regex_count; i++) {
+        size_t from = 0;
+        
+        while (from <= limit) {
+            regmatch_t match;
+            match.rm_so = (regoff_t)from;
+            match.rm_eo = (regoff_t)limit;
+            if (regexec(&m->regexes[i], buf, 1, &match, REG_STARTEND) != 0) {
+                break;
+            }
+            
+            size_t so = (size_t)match.rm_so;
+            const char* nl = memchr(buf + so, '\n', limit - so);
+            size_t line_end = nl ? (size_t)(nl - buf) : limit;
+            
+            if ((size_t)match.rm_eo > line_end) {
+                const char* prev = memrchr(buf + from, '\n', so - from);
+                match.rm_so = (regoff_t)(prev ? (size_t)(prev - buf) + 1 : from);
+                match.rm_eo = (regoff_t)line_end;
+                if (regexec(&m->regexes[i], buf, 1, &match, REG_STARTEND) != 0) {
+                    from = line_end + 1;
+                    continue;
+                }
+                so = (size_t)match.rm_so;
+            }
+            
+            best = buf + so;
+            limit = line_end;
+            break;
+        }
+    }
+    
+    // 줄 번호가 아니라 매치 위치만 필요하므로 같은 줄 안에서의 순서는 상관없다
+    return best;
+}
+
+// buf[pos, len) 에서 다음 매칭 줄을 찾아 [*line_start, *line_end) 로 돌려준다
+// 매치 위치만 찾은 뒤 그 주변에서만 줄 경계('\n')를 찾는다
+int matcher_next_line(const grep_matcher* m, const char* buf, size_t len, size_t pos,
+                      size_t* line_start, size_t* line_end) {
+    const char* hit = NULL;
+    
+    if (m->match_all) {
+        hit = buf + pos;
+    } else if (m->kind == MATCHER_LITERAL) {
+        hit = literal_find(m, buf + pos, len - pos);
+    } else if (m->kind == MATCHER_AHO_CORASICK) {
+        hit = ac_find(m, buf + pos, len - pos);
+    } else if (m->kind == MATCHER_DFA && (m->lit_len == 0 || dfa_filter_off(m))) {
+        hit = dfa_find(m, buf + pos, len - pos);
+    } else if (m->kind == MATCHER_DFA) {
+        // 접두 필터: 고정 문자열이 들어 있는 줄만 DFA로 확인한다
+        dfa_cache* c = dfa_get_cache(m);
+        while (pos < len && c) {
+            const char* cand = literal_find(m, buf + pos, len - pos);
+            if (!cand) {
+                break;
+            }
+            
+            const char* start = memrchr(buf + pos, '\n', (size_t)(cand - (buf + pos)));
+            const char* end = memchr(cand, '\n', len - (size_t)(cand - buf));
+            size_t cand_start = start ? (size_t)(start - buf) + 1 : pos;
+            size_t cand_end = end ? (size_t)(end - buf) : len;
+            
+            c->filter_skipped += cand_start - pos;
+            c->filter_checked += cand_end - cand_start;
+            
+            hit = dfa_find(m, buf + cand_start, cand_end - cand_start);
+            if (hit) {
+                break;
+            }
+            pos = cand_end + 1;
+            
+            // 거의 모든 줄이 후보라면 필터 비용만 늘어나므로 DFA만으로 검사한다
+            if (dfa_filter_off(m)) {
+                hit = pos < len ? dfa_find(m, buf + pos, len - pos) : NULL;
+                break;
+            }
+        }
+    } else {
+        // regoff_t가 int이므로 줄 단위로 끊은 창(window) 단위로 검사한다
+        while (pos < len && !hit) {
+            size_t win_end = len;
+            if (len - pos > REGEX_WINDOW_SIZE) {
+                const char* nl = memchr(buf + pos + REGEX_WINDOW_SIZE, '\n',
+                                        len - pos - REGEX_WINDOW_SIZE);
+                win_end = nl ? (size_t)(nl - buf) : len;
+            }
+            
+            hit = regex_find(m, buf + pos, win_end - pos);
+            pos = win_end + 1;
+        }
+    }
+    
+    if (!hit) {
+        return 0;
+    }
+    
+    const char* start = memrchr(buf, '\n', (size_t)(hit - buf));
+    const char* end = memchr(hit, '\n', len - (size_t)(hit - buf));
+    *line_start = start ? (size_t)(start - buf) + 1 : 0;
+    *line_end = end ? (size_t)(end - buf) : len;
+    return 1;
+}
+
+// 파일 하나를 검색하는 동안의 상태
 typedef struct {
-    char* pattern;
-    int ignore_case;     // -i 옵션
-} grep_options;
+    const grep_matcher* matcher;
+    const grep_options* opts;
+    const char* filename;
+    int multiple_files;
+    FILE* out;
+    long count;                 // 매칭된 줄 수
+    int stop;                   // 더 읽지 않아도 됨 (-l, -q, -m)
+    int* cancel;                // -q 에서 다른 파일이 이미 매칭되면 1 (풀 전체가 공유)
+} search_ctx;
 
-int search_file(const char* filename, grep_options* opts, int multiple_files) {
-    FILE* file;
-    char line[4096];
-    int found = 0;
-    regex_t regex;
-    int regex_flags = REG_NOSUB;
+// 완전한 줄들로 이루어진 버퍼를 검사해 매칭된 줄을 그대로 출력한다 (복사 없음)
+void scan_buffer(search_ctx* ctx, const char* buf, size_t len) {
+    size_t pos = 0;
+    size_t line_start, line_end;
     
-    // 대소문자 무시 옵션 설정
-    if (opts->ignore_case) {
-        regex_flags |= REG_ICASE;
+    while (!ctx->stop && pos < len &&
+           matcher_next_line(ctx->matcher, buf, len, pos, &line_start, &line_end)) {
+        ctx->count++;
+        pos = line_end + 1;
+        
+        if (ctx->opts->mode == OUTPUT_LINES) {
+            // 파일명 출력 (여러 파일인 경우)
+            if (ctx->multiple_files) {
+                fprintf(ctx->out, "%s:", ctx->filename);
+            }
+            
+            // 매칭된 줄 출력
+            fwrite(buf + line_start, 1, line_end - line_start, ctx->out);
+            putc('\n', ctx->out);
+        } else if (ctx->opts->mode != OUTPUT_COUNT) {
+            // -l, -q 는 첫 매치만 확인하면 된다
+            ctx->stop = 1;
+            if (ctx->opts->mode == OUTPUT_QUIET && ctx->cancel) {
+                __atomic_store_n(ctx->cancel, 1, __ATOMIC_RELAXED);
+            }
+        }
+        
+        if (ctx->opts->max_count >= 0 && ctx->count >= ctx->opts->max_count) {
+            ctx->stop = 1;
+        }
     }
+}
+
+// 파이프/표준 입력: 큰 블록으로 읽고, 완성된 줄까지만 검사한 뒤 나머지는 다음 블록으로 넘긴다
+int scan_stream(search_ctx* ctx, int fd) {
+    size_t capacity = READ_BLOCK_SIZE;
+    size_t fill = 0;
+    char* buf = malloc(capacity);
     
-    // 정규표현식 컴파일
-    int ret = regcomp(&regex, opts->pattern, regex_flags);
-    if (ret != 0) {
-        char error_msg[256];
-        regerror(ret, &regex, error_msg, sizeof(error_msg));
-        fprintf(stderr, "grep: 잘못된 정규표현식: %s\n", error_msg);
+    if (!buf) {
+        fprintf(stderr, "grep: 메모리 할당 실패\n");
         return -1;
     }
     
+    while (!ctx->stop) {
+        // 다른 파일에서 이미 -q 매치가 나왔으면 중단
+        if (ctx->cancel && __atomic_load_n(ctx->cancel, __ATOMIC_RELAXED)) {
+            break;
+        }
+        
+        // 한 줄이 버퍼보다 길면 버퍼를 늘린다
+        if (fill == capacity) {
+            char* temp = realloc(buf, capacity * 2);
+            if (!temp) {
+                fprintf(stderr, "grep: 메모리 할당 실패\n");
+                free(buf);
+                return -1;
+            }
+            buf = temp;
+            capacity *= 2;
+        }
+        
+        ssize_t n = read(fd, buf + fill, capacity - fill);
+        if (n < 0) {
+            fprintf(stderr, "grep: %s: 읽기 오류\n", ctx->filename);
+            free(buf);
+            return -1;
+        }
+        if (n == 0) {
+            // 개행 문자로 끝나지 않은 마지막 줄
+            if (fill > 0) {
+                scan_buffer(ctx, buf, fill);
+            }
+            break;
+        }
+        
+        size_t scanned = fill;
+        fill += (size_t)n;
+        
+        const char* last_nl = memrchr(buf + scanned, '\n', fill - scanned);
+        if (!last_nl) {
+            continue;
+        }
+        
+        size_t complete = (size_t)(last_nl - buf) + 1;
+        scan_buffer(ctx, buf, complete);
+        memmove(buf, buf + complete, fill - complete);
+        fill -= complete;
+    }
+    
+    free(buf);
+    return 0;
+}
+
+int search_file(const char* filename, const grep_matcher* matcher, const grep_options* opts,
+                int multiple_files, FILE* out, int* cancel) {
+    search_ctx ctx = { matcher, opts, filename, multiple_files, out, 0, 0, cancel };
+    int fd;
+    int ret = 0;
+    struct stat st;
+    
+    // -m 0 이면 파일을 열 필요도 없다
+    if (opts->max_count == 0) {
+        ctx.stop = 1;
+    }
+    
     // 파일 열기
     if (strcmp(filename, "-") == 0) {
-        file = stdin;
+        fd = STDIN_FILENO;
     } else {
-        file = fopen(filename, "r");
-        if (!file) {
+        fd = open(filename, O_RDONLY);
+        if (fd < 0) {
             fprintf(stderr, "grep: %s: 파일을 열 수 없습니다\n", filename);
-            regfree(&regex);
             return 2;
         }
     }
     
-    // 파일을 줄 단위로 읽기
-    while (fgets(line, sizeof(line), file) != NULL) {
-        // 줄 끝의 개행 문자 제거
-        size_t len = strlen(line);
-        if (len > 0 && line[len-1] == '\n') {
-            line[len-1] = '\0';
+    // 일반 파일은 통째로 매핑해서 줄 단위 복사 없이 검사
+    if (ctx.stop) {
+        // 읽지 않음
+    } else if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+        size_t size = (size_t)st.st_size;
+        char* data = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        
+        if (data != MAP_FAILED) {
+            madvise(data, size, MADV_SEQUENTIAL);
+            scan_buffer(&ctx, data, size);
+            munmap(data, size);
+        } else {
+            ret = scan_stream(&ctx, fd);
+        }
+    } else {
+        ret = scan_stream(&ctx, fd);
+    }
+    
+    if (fd != STDIN_FILENO) {
+        close(fd);
+    }
+    
+    if (ret < 0) {
+        return 2;
+    }
+    
+    if (opts->mode == OUTPUT_COUNT) {
+        if (multiple_files) {
+            fprintf(out, "%s:", filename);
+        }
+        fprintf(out, "%ld\n", ctx.count);
+    } else if (opts->mode == OUTPUT_FILES && ctx.count > 0) {
+        fprintf(out, "%s\n", filename);
+    }
+    
+    return ctx.count > 0 ? 0 : 1;
+}
+
+// 여러 파일을 동시에 검색하는 작업자 풀
+// 각 파일의 출력은 메모리에 모아 두었다가 정해진 순서대로 내보낸다
+// 출력 차례가 된 파일은 모으지 않고 바로 쓰며, 모아 둔 양이 OUTPUT_BUDGET 을 넘으면
+// 다른 작업자는 출력이 따라올 때까지 기다린다
+// -r 이면 디렉토리도 작업으로 들어가고, 디렉토리를 읽은 작업자가 찾은 파일을 바로 큐에 넣는다
+
+// -R 에서 순환 링크를 막기 위한 상위 디렉토리 사슬 (참조 카운트로 공유)
+typedef struct dir_node {
+    dev_t dev;
+    ino_t ino;
+    struct dir_node* parent;
+    int refs;
+} dir_node;
+
+// 출력 자리 하나 (파일 또는 디렉토리)
+// 디렉토리의 자식은 디렉토리를 읽은 순서대로 children 에 들어가고, 출력은 이 나무를
+// 깊이 우선으로 따라가므로 작업자 수나 스레드 타이밍과 관계없이 순서가 같다
+typedef struct output_slot {
+    char* path;
+    int is_dir;
+    dir_node* parent;           // 디렉토리 작업의 상위 디렉토리 (-R)
+    
+    char* output;               // 파일: 모아 둔 출력
+    size_t size;
+    size_t capacity;
+    int result;
+    int started;                // 작업자나 출력 스레드가 맡았음
+    int live;                   // 출력 차례: 모으지 않고 바로 표준 출력으로 쓴다
+    int done;                   // 파일은 검색이, 디렉토리는 children 채우기가 끝남
+    
+    struct output_slot** children;
+    int child_count;
+    int child_capacity;
+} output_slot;
+
+typedef struct {
+    const grep_matcher* matcher;
+    const grep_options* opts;
+    int multiple_files;
+    int follow_links;           // -R
+    int quiet_matched;          // -q 에서 매치가 나오면 남은 작업은 건너뛴다
+    
+    output_slot** queue;        // 원형 덱 (디렉토리의 자식은 앞에 넣는다, 출력 스레드가 가져가면 NULL)
+    size_t queue_head;
+    size_t queue_count;
+    size_t queue_capacity;
+    int pending;                // 큐에 있거나 처리 중인 작업 수
+    
+    output_slot root;           // 명령행 인수들이 자식인 가상의 디렉토리
+    size_t buffered;            // 출력 차례를 기다리며 모아 둔 바이트 수
+    
+    int error;
+    pthread_mutex_t lock;
+    pthread_cond_t job_ready;
+    pthread_cond_t file_done;
+    pthread_cond_t output_drained;
+} search_pool;
+
+// lock을 잡은 상태에서 호출
+void dir_node_release(dir_node* node) {
+    while (node && --node->refs == 0) {
+        dir_node* parent = node->parent;
+        free(node);
+        node = parent;
+    }
+}
+
+// 자식 출력 자리를 만들어 parent_slot 의 children 끝에 붙인다 (parent_slot 이 끝나기 전에만 호출)
+output_slot* slot_add_child(output_slot* parent_slot, char* path, int is_dir, dir_node* parent) {
+    if (parent_slot->child_count == parent_slot->child_capacity) {
+        int capacity = parent_slot->child_capacity ? parent_slot->child_capacity * 2 : 16;
+        output_slot** temp = realloc(parent_slot->children, sizeof(output_slot*) * (size_t)capacity);
+        if (!temp) {
+            return NULL;
+        }
+        parent_slot->children = temp;
+        parent_slot->child_capacity = capacity;
+    }
+    
+    output_slot* slot = calloc(1, sizeof(output_slot));
+    if (!slot) {
+        return NULL;
+    }
+    slot->path = path;
+    slot->is_dir = is_dir;
+    slot->parent = parent;
+    parent_slot->children[parent_slot->child_count++] = slot;
+    return slot;
+}
+
+// lock을 잡은 상태에서 호출
+// front 면 덱 앞에 넣어 출력 순서(깊이 우선)와 처리 순서가 비슷해지게 한다
+int pool_push(search_pool* pool, output_slot* slot, int front) {
+    if (pool->queue_count == pool->queue_capacity) {
+        size_t capacity = pool->queue_capacity ? pool->queue_capacity * 2 : 256;
+        output_slot** temp = malloc(sizeof(output_slot*) * capacity);
+        if (!temp) {
+            return -1;
+        }
+        for (size_t i = 0; i < pool->queue_count; i++) {
+            temp[i] = pool->queue[(pool->queue_head + i) % pool->queue_capacity];
+        }
+        free(pool->queue);
+        pool->queue = temp;
+        pool->queue_head = 0;
+        pool->queue_capacity = capacity;
+    }
+    
+    if (front) {
+        pool->queue_head = (pool->queue_head + pool->queue_capacity - 1) % pool->queue_capacity;
+        pool->queue[pool->queue_head] = slot;
+    } else {
+        pool->queue[(pool->queue_head + pool->queue_count) % pool->queue_capacity] = slot;
+    }
+    pool->queue_count++;
+    pool->pending++;
+    if (slot->parent) {
+        slot->parent->refs++;
+    }
+    pthread_cond_signal(&pool->job_ready);
+    return 0;
+}
+
+char* join_path(const char* dir, const char* name) {
+    size_t dir_len = strlen(dir);
+    size_t name_len = strlen(name);
+    char* path = malloc(dir_len + name_len + 2);
+    
+    if (!path) {
+        return NULL;
+    }
+    
+    // 인수 없이 -r 이면 현재 디렉토리 기준 상대 경로로 출력
+    if (dir_len == 0) {
+        memcpy(path, name, name_len + 1);
+        return path;
+    }
+    
+    memcpy(path, dir, dir_len);
+    if (dir[dir_len - 1] != '/') {
+        path[dir_len++] = '/';
+    }
+    memcpy(path + dir_len, name, name_len + 1);
+    return path;
+}
+
+// getdents64()로 디렉토리를 읽어 d_type으로 파일/디렉토리를 구분해 큐에 넣는다
+// d_type을 모르거나 -R에서 심볼릭 링크를 만났을 때만 fstatat()을 호출한다
+struct linux_dirent64 {
+    ino64_t d_ino;
+    off64_t d_off;
+    unsigned short d_reclen;
+    unsigned char d_type;
+    char d_name[];
+};
+
+void walk_directory(search_pool* pool, output_slot* dir_slot) {
+    const char* path = dir_slot->path;
+    dir_node* parent = dir_slot->parent;
+    int dir_fd = openat(AT_FDCWD, path[0] ? path : ".", O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (dir_fd < 0) {
+        fprintf(stderr, "grep: %s: 디렉토리를 열 수 없습니다\n", path[0] ? path : ".");
+        pthread_mutex_lock(&pool->lock);
+        pool->error = 1;
+        pthread_mutex_unlock(&pool->lock);
+        return;
+    }
+    
+    // 상위 디렉토리 중 같은 디렉토리가 있으면 링크가 순환하는 것
+    dir_node* self = NULL;
+    if (pool->follow_links) {
+        struct stat st;
+        if (fstat(dir_fd, &st) == 0) {
+            for (dir_node* node = parent; node; node = node->parent) {
+                if (node->dev == st.st_dev && node->ino == st.st_ino) {
+                    fprintf(stderr, "grep: %s: 순환하는 디렉토리 링크입니다\n", path);
+                    close(dir_fd);
+                    return;
+                }
+            }
+            
+            self = malloc(sizeof(dir_node));
+            if (self) {
+                self->dev = st.st_dev;
+                self->ino = st.st_ino;
+                self->parent = parent;
+                self->refs = 1;
+                pthread_mutex_lock(&pool->lock);
+                if (parent) {
+                    parent->refs++;
+                }
+                pthread_mutex_unlock(&pool->lock);
+            }
+        }
+    }
+    
+    char* buf = malloc(DIRENT_BUF_SIZE);
+    if (!buf) {
+        fprintf(stderr, "grep: 메모리 할당 실패\n");
+        close(dir_fd);
+        pthread_mutex_lock(&pool->lock);
+        dir_node_release(self);
+        pthread_mutex_unlock(&pool->lock);
+        return;
+    }
+    
+    for (;;) {
+        long n = syscall(SYS_getdents64, dir_fd, buf, DIRENT_BUF_SIZE);
+        if (n <= 0) {
+            if (n < 0) {
+                fprintf(stderr, "grep: %s: 디렉토리를 읽을 수 없습니다\n", path);
+            }
+            break;
         }
         
-        // 패턴 매칭
-        if (regexec(&regex, line, 0, NULL, 0) == 0) {
-            found = 1;
+        for (long off = 0; off < n;) {
+            struct linux_dirent64* entry = (struct linux_dirent64*)(buf + off);
+            off += entry->d_reclen;
             
-            // 파일명 출력 (여러 파일인 경우)
-            if (multiple_files) {
-                printf("%s:", filename);
+            // . 과 .. 은 건너뛰기
+            if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) {
+                continue;
             }
             
-            // 매칭된 줄 출력
-            printf("%s\n", line);
+            unsigned char type = entry->d_type;
+            if (type == DT_UNKNOWN || (type == DT_LNK && pool->follow_links)) {
+                struct stat st;
+                int flags = pool->follow_links ? 0 : AT_SYMLINK_NOFOLLOW;
+                if (fstatat(dir_fd, entry->d_name, &st, flags) != 0) {
+                    continue;
+                }
+                type = S_ISDIR(st.st_mode) ? DT_DIR : S_ISREG(st.st_mode) ? DT_REG : DT_UNKNOWN;
+            }
+            
+            // -r 에서는 심볼릭 링크, 장치 파일 등을 검색하지 않는다
+            if (type != DT_DIR && type != DT_REG) {
+                continue;
+            }
+            
+            char* child = join_path(path, entry->d_name);
+            if (!child) {
+                continue;
+            }
+            
+            if (!slot_add_child(dir_slot, child, type == DT_DIR, type == DT_DIR ? self : NULL)) {
+                fprintf(stderr, "grep: 메모리 할당 실패\n");
+                pthread_mutex_lock(&pool->lock);
+                pool->error = 1;
+                pthread_mutex_unlock(&pool->lock);
+                free(child);
+            }
+        }
+    }
+    
+    free(buf);
+    close(dir_fd);
+    
+    // 첫 자식이 덱 맨 앞에 오도록 거꾸로 넣는다
+    pthread_mutex_lock(&pool->lock);
+    for (int i = dir_slot->child_count - 1; i >= 0; i--) {
+        if (pool_push(pool, dir_slot->children[i], 1) != 0) {
+            fprintf(stderr, "grep: 메모리 할당 실패\n");
+            pool->error = 1;
+            dir_slot->children[i]->started = 1;
+            dir_slot->children[i]->done = 1;
+            dir_slot->children[i]->result = 2;
+        }
+    }
+    dir_node_release(self);
+    pthread_mutex_unlock(&pool->lock);
+}
+
+// 작업자 출력 스트림 (fopencookie)
+typedef struct {
+    search_pool* pool;
+    output_slot* slot;
+} slot_stream;
+
+ssize_t slot_write(void* cookie, const char* data, size_t size) {
+    slot_stream* stream = cookie;
+    search_pool* pool = stream->pool;
+    output_slot* slot = stream->slot;
+    
+    pthread_mutex_lock(&pool->lock);
+    while (!slot->live && pool->buffered >= OUTPUT_BUDGET) {
+        pthread_cond_wait(&pool->output_drained, &pool->lock);
+    }
+    
+    // 출력 차례가 되었으면 모아 둔 것부터 내보내고 이후로는 바로 쓴다
+    if (slot->live) {
+        char* held = slot->output;
+        size_t held_size = slot->size;
+        slot->output = NULL;
+        slot->size = 0;
+        slot->capacity = 0;
+        pool->buffered -= held_size;
+        pthread_cond_broadcast(&pool->output_drained);
+        pthread_mutex_unlock(&pool->lock);
+        
+        if (held) {
+            fwrite(held, 1, held_size, stdout);
+            free(held);
+        }
+        fwrite(data, 1, size, stdout);
+        return (ssize_t)size;
+    }
+    
+    if (slot->size + size > slot->capacity) {
+        size_t capacity = slot->capacity ? slot->capacity : OUTPUT_STREAM_BUFFER;
+        while (capacity < slot->size + size) {
+            capacity *= 2;
+        }
+        char* temp = realloc(slot->output, capacity);
+        if (!temp) {
+            pthread_mutex_unlock(&pool->lock);
+            return -1;
+        }
+        slot->output = temp;
+        slot->capacity = capacity;
+    }
+    memcpy(slot->output + slot->size, data, size);
+    slot->size += size;
+    pool->buffered += size;
+    pthread_mutex_unlock(&pool->lock);
+    return (ssize_t)size;
+}
+
+// 출력 자리 하나를 처리한다 (작업자 또는 출력 스레드)
+void run_slot(search_pool* pool, output_slot* slot) {
+    if (__atomic_load_n(&pool->quiet_matched, __ATOMIC_RELAXED)) {
+        slot->result = 1;
+    } else if (slot->is_dir) {
+        walk_directory(pool, slot);
+    } else {
+        slot_stream stream = { pool, slot };
+        cookie_io_functions_t io = { NULL, slot_write, NULL, NULL };
+        FILE* out = fopencookie(&stream, "w", io);
+        if (out) {
+            setvbuf(out, NULL, _IOFBF, OUTPUT_STREAM_BUFFER);
+            slot->result = search_file(slot->path, pool->matcher, pool->opts,
+                                       pool->multiple_files, out, &pool->quiet_matched);
+            fclose(out);
+        } else {
+            fprintf(stderr, "grep: 메모리 할당 실패\n");
+            slot->result = 2;
+        }
+    }
+    free(slot->path);
+    slot->path = NULL;
+    
+    pthread_mutex_lock(&pool->lock);
+    slot->done = 1;
+    dir_node_release(slot->parent);
+    pthread_cond_broadcast(&pool->file_done);
+    pthread_mutex_unlock(&pool->lock);
+}
+
+void* search_worker(void* arg) {
+    search_pool* pool = arg;
+    
+    for (;;) {
+        pthread_mutex_lock(&pool->lock);
+        while (pool->queue_count == 0 && pool->pending > 0) {
+            pthread_cond_wait(&pool->job_ready, &pool->lock);
+        }
+        if (pool->queue_count == 0) {
+            pthread_mutex_unlock(&pool->lock);
+            break;
+        }
+        
+        output_slot* slot = pool->queue[pool->queue_head];
+        pool->queue_head = (pool->queue_head + 1) % pool->queue_capacity;
+        pool->queue_count--;
+        if (slot) {
+            slot->started = 1;
+        }
+        pthread_mutex_unlock(&pool->lock);
+        
+        // 출력 스레드가 먼저 가져간 자리는 빈칸으로 남아 있다
+        if (slot) {
+            run_slot(pool, slot);
+        }
+        
+        pthread_mutex_lock(&pool->lock);
+        pool->pending--;
+        
+        // 모든 작업이 끝나면 기다리는 작업자를 깨운다
+        if (pool->pending == 0) {
+            pthread_cond_broadcast(&pool->job_ready);
+        }
+        pthread_mutex_unlock(&pool->lock);
+    }
+    
+    return NULL;
+}
+
+// 출력 자리 나무를 깊이 우선으로 따라가며 끝나기를 기다렸다가 출력한다
+// 차례가 된 자리가 아직 큐에 있으면 작업자가 모두 예산에 막혀 있을 수 있으므로 직접 처리한다
+void print_slot(search_pool* pool, output_slot* slot, int* exit_code) {
+    pthread_mutex_lock(&pool->lock);
+    slot->live = 1;
+    pthread_cond_broadcast(&pool->output_drained);
+    
+    if (!slot->started) {
+        slot->started = 1;
+        for (size_t i = 0; i < pool->queue_count; i++) {
+            size_t pos = (pool->queue_head + i) % pool->queue_capacity;
+            if (pool->queue[pos] == slot) {
+                pool->queue[pos] = NULL;
+                break;
+            }
+        }
+        pthread_mutex_unlock(&pool->lock);
+        run_slot(pool, slot);
+        pthread_mutex_lock(&pool->lock);
+    }
+    
+    while (!slot->done) {
+        pthread_cond_wait(&pool->file_done, &pool->lock);
+    }
+    char* output = slot->output;
+    size_t size = slot->size;
+    slot->output = NULL;
+    pool->buffered -= size;
+    pthread_cond_broadcast(&pool->output_drained);
+    pthread_mutex_unlock(&pool->lock);
+    
+    if (output) {
+        fwrite(output, 1, size, stdout);
+    }
+    free(output);
+    
+    if (!slot->is_dir) {
+        if (slot->result == 0) {
+            *exit_code = 0; // 매칭 발견
+        } else if (slot->result == 2) {
+            *exit_code = 2; // 에러 발생
+        }
+    }
+    
+    for (int i = 0; i < slot->child_count; i++) {
+        print_slot(pool, slot->children[i], exit_code);
+        free(slot->children[i]);
+    }
+    free(slot->children);
+}
+
+int search_files_parallel(char** files, int file_count, const grep_matcher* matcher,
+                          const grep_options* opts) {
+    search_pool pool = {0};
+    int exit_code = 1;
+    int threads = opts->threads;
+    
+    pool.matcher = matcher;
+    pool.opts = opts;
+    pool.multiple_files = file_count > 1 || opts->recursive;
+    pool.follow_links = opts->recursive == 2;
+    pool.root.is_dir = 1;
+    pool.root.started = 1;
+    pool.root.done = 1;
+    pthread_mutex_init(&pool.lock, NULL);
+    pthread_cond_init(&pool.job_ready, NULL);
+    pthread_cond_init(&pool.file_done, NULL);
+    pthread_cond_init(&pool.output_drained, NULL);
+    
+    // 명령행 인수를 먼저 큐에 넣는다 (-r 이면 디렉토리는 탐색 작업으로)
+    for (int i = 0; i < file_count; i++) {
+        struct stat st;
+        int is_dir = opts->recursive && stat(files[i], &st) == 0 && S_ISDIR(st.st_mode);
+        char* path = strdup(files[i]);
+        output_slot* slot = path ? slot_add_child(&pool.root, path, is_dir, NULL) : NULL;
+        
+        if (!slot || pool_push(&pool, slot, 0) != 0) {
+            fprintf(stderr, "grep: 메모리 할당 실패\n");
+            if (!slot) {
+                free(path);
+            } else {
+                pool.root.child_count--;
+                free(slot);
+            }
+            exit_code = 2;
+            break;
+        }
+    }
+    if (file_count == 0) {
+        char* path = strdup("");
+        output_slot* slot = path ? slot_add_child(&pool.root, path, 1, NULL) : NULL;
+        if (!slot || pool_push(&pool, slot, 0) != 0) {
+            fprintf(stderr, "grep: 메모리 할당 실패\n");
+            if (!slot) {
+                free(path);
+            } else {
+                pool.root.child_count--;
+                free(slot);
+            }
+            exit_code = 2;
+        }
+    }
+    
+    // 디렉토리가 있으면 파일 수를 미리 알 수 없으므로 인수 개수로 제한하지 않는다
+    if (!opts->recursive && threads > file_count) {
+        threads = file_count;
+    }
+    
+    pthread_t* workers = malloc(sizeof(pthread_t) * (size_t)threads);
+    int started = 0;
+    if (workers) {
+        for (; started < threads; started++) {
+            if (pthread_create(&workers[started], NULL, search_worker, &pool) != 0) {
+                break;
+            }
+        }
+    }
+    
+    // 스레드를 하나도 만들지 못하면 출력 스레드가 차례대로 직접 처리한다
+    // 끝난 파일부터가 아니라 정해진 순서대로 출력
+    print_slot(&pool, &pool.root, &exit_code);
+    
+    for (int i = 0; i < started; i++) {
+        pthread_join(workers[i], NULL);
+    }
+    
+    if (pool.error) {
+        exit_code = 2;
+    }
+    
+    // -q 는 오류가 있었더라도 매치가 하나라도 있으면 성공
+    if (opts->mode == OUTPUT_QUIET && pool.quiet_matched) {
+        exit_code = 0;
+    }
+    
+    free(workers);
+    free(pool.queue);
+    pthread_mutex_destroy(&pool.lock);
+    pthread_cond_destroy(&pool.job_ready);
+    pthread_cond_destroy(&pool.file_done);
+    pthread_cond_destroy(&pool.output_drained);
+    return exit_code;
+}
+
+// 패턴 목록에 추가, 패턴 안의 개행 문자는 GNU grep처럼 패턴 구분자로 취급한다
+int add_patterns(grep_options* opts, int* capacity, const char* text) {
+    for (;;) {
+        const char* nl = strchr(text, '\n');
+        size_t len = nl ? (size_t)(nl - text) : strlen(text);
+        
+        if (opts->pattern_count == *capacity) {
+            int new_capacity = *capacity ? *capacity * 2 : 16;
+            char** temp = realloc(opts->patterns, sizeof(char*) * (size_t)new_capacity);
+            if (!temp) {
+                return -1;
+            }
+            opts->patterns = temp;
+            *capacity = new_capacity;
+        }
+        
+        char* pattern = strndup(text, len);
+        if (!pattern) {
+            return -1;
+        }
+        opts->patterns[opts->pattern_count++] = pattern;
+        
+        if (!nl) {
+            return 0;
+        }
+        text = nl + 1;
+    }
+}
+
+// -f 패턴파일: 한 줄에 패턴 하나
+int load_pattern_file(grep_options* opts, int* capacity, const char* filename) {
+    FILE* file = strcmp(filename, "-") == 0 ? stdin : fopen(filename, "r");
+    if (!file) {
+        fprintf(stderr, "grep: %s: 파일을 열 수 없습니다\n", filename);
+        return -1;
+    }
+    
+    char* line = NULL;
+    size_t len = 0;
+    ssize_t read;
+    int ret = 0;
+    
+    while ((read = getline(&line, &len, file)) != -1) {
+        if (read > 0 && line[read - 1] == '\n') {
+            line[read - 1] = '\0';
+        }
+        if (add_patterns(opts, capacity, line) != 0) {
+            fprintf(stderr, "grep: 메모리 할당 실패\n");
+            ret = -1;
+            break;
         }
     }
     
+    free(line);
     if (file != stdin) {
         fclose(file);
     }
-    
-    regfree(&regex);
-    return found ? 0 : 1;
+    return ret;
+}
+
+void free_patterns(grep_options* opts) {
+    for (int i = 0; i < opts->pattern_count; i++) {
+        free(opts->patterns[i]);
+    }
+    free(opts->patterns);
 }
 
 int main(int argc, char* argv[]) {
     grep_options opts = {0};
     int i;
-    int file_start_index = -1;
+    
+    opts.max_count = -1;
+    char** files = malloc(sizeof(char*) * (size_t)argc);
+    int file_count = 0;
+    int pattern_capacity = 0;
+    int pattern_given = 0;       // -e/-f 가 있으면 비옵션 인수는 모두 파일
+    char* positional_pattern = NULL;
     int exit_code = 1;
     
+    if (!files) {
+        fprintf(stderr, "grep: 메모리 할당 실패\n");
+        return 2;
+    }
+    
     // 명령행 인수 파싱
     for (i = 1; i < argc; i++) {
         if (strcmp(argv[i], "-i") == 0) {
             opts.ignore_case = 1;
-        } else if (argv[i][0] == '-') {
+        } else if (strcmp(argv[i], "-F") == 0) {
+            opts.fixed_string = 1;
+        } else if (strcmp(argv[i], "-E") == 0) {
+            opts.extended = 1;
+        } else if (strcmp(argv[i], "--dfa") == 0) {
+            opts.extended = 1;
+            opts.use_dfa = 1;
+        } else if (strcmp(argv[i], "-c") == 0) {
+            if (opts.mode == OUTPUT_LINES) {
+                opts.mode = OUTPUT_COUNT;
+            }
+        } else if (strcmp(argv[i], "-l") == 0) {
+            if (opts.mode != OUTPUT_QUIET) {
+                opts.mode = OUTPUT_FILES;
+            }
+        } else if (strcmp(argv[i], "-q") == 0) {
+            opts.mode = OUTPUT_QUIET;
+        } else if (strcmp(argv[i], "-m") == 0) {
+            char* end;
+            if (i + 1 >= argc || (opts.max_count = strtol(argv[i + 1], &end, 10)) < 0 ||
+                *end != '\0' || end == argv[i + 1]) {
+                fprintf(stderr, "grep: -m 옵션에는 0 이상의 정수가 필요합니다\n");
+                free_patterns(&opts);
+                free(files);
+                return 2;
+            }
+            i++;
+        } else if (strcmp(argv[i], "-r") == 0) {
+            opts.recursive = 1;
+        } else if (strcmp(argv[i], "-R") == 0) {
+            opts.recursive = 2;
+        } else if (strcmp(argv[i], "-j") == 0) {
+            if (i + 1 >= argc || atoi(argv[i + 1]) <= 0) {
+                fprintf(stderr, "grep: -j 옵션에는 양의 정수가 필요합니다\n");
+                free_patterns(&opts);
+                free(files);
+                return 2;
+            }
+            opts.threads = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-e") == 0 || strcmp(argv[i], "-f") == 0) {
+            if (i + 1 >= argc) {
+                fprintf(stderr, "grep: %s 옵션에는 인수가 필요합니다\n", argv[i]);
+                free_patterns(&opts);
+                free(files);
+                return 2;
+            }
+            
+            int ret;
+            if (argv[i][1] == 'e') {
+                ret = add_patterns(&opts, &pattern_capacity, argv[i + 1]);
+                if (ret != 0) {
+                    fprintf(stderr, "grep: 메모리 할당 실패\n");
+                }
+            } else {
+                ret = load_pattern_file(&opts, &pattern_capacity, argv[i + 1]);
+            }
+            if (ret != 0) {
+                free_patterns(&opts);
+                free(files);
+                return 2;
+            }
+            
+            pattern_given = 1;
+            i++;
+        } else if (argv[i][0] == '-' && argv[i][1] != '\0') {
             fprintf(stderr, "grep: 알 수 없는 옵션: %s\n", argv[i]);
+            free_patterns(&opts);
+            free(files);
             return 2;
         } else {
-            // 첫 번째 비옵션 인수는 패턴
-            if (!opts.pattern) {
-                opts.pattern = argv[i];
+            // 첫 번째 비옵션 인수는 패턴, 나머지는 파일
+            if (!positional_pattern) {
+                positional_pattern = argv[i];
             } else {
-                // 파일 시작 위치 기록
-                if (file_start_index == -1) {
-                    file_start_index = i;
-                }
+                files[file_count++] = argv[i];
             }
         }
     }
     
-    // 패턴이 없으면 에러
-    if (!opts.pattern) {
+    // -e/-f 가 있으면 첫 번째 비옵션 인수도 파일이다
+    if (pattern_given) {
+        if (positional_pattern) {
+            memmove(files + 1, files, sizeof(char*) * (size_t)file_count);
+            files[0] = positional_pattern;
+            file_count++;
+        }
+    } else if (positional_pattern) {
+        if (add_patterns(&opts, &pattern_capacity, positional_pattern) != 0) {
+            fprintf(stderr, "grep: 메모리 할당 실패\n");
+            free(files);
+            return 2;
+        }
+    } else {
+        // 패턴이 없으면 에러
         fprintf(stderr, "grep: 패턴이 필요합니다\n");
+        free(files);
         return 2;
     }
     
-    // 파일이 지정되지 않은 경우 표준 입력 사용
-    if (file_start_index == -1) {
-        exit_code = search_file("-", &opts, 0);
-    } else {
-        // 여러 파일 처리
-        int multiple_files = (argc - file_start_index) > 1;
-        
-        for (i = file_start_index; i < argc; i++) {
-            int result = search_file(argv[i], &opts, multiple_files);
+    if (opts.threads <= 0) {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        opts.threads = cpus > 0 ? (int)cpus : 1;
+    }
+    
+    // 패턴은 파일 수와 관계없이 한 번만 컴파일
+    grep_matcher matcher;
+    if (matcher_compile(&matcher, &opts) != 0) {
+        matcher_free(&matcher);
+        free_patterns(&opts);
+        free(files);
+        return 2;
+    }
+    
+    if (opts.recursive) {
+        // 디렉토리 탐색과 검색을 같은 작업자 풀에서 처리 (인수가 없으면 현재 디렉토리)
+        exit_code = search_files_parallel(files, file_count, &matcher, &opts);
+    } else if (file_count == 0) {
+        // 파일이 지정되지 않은 경우 표준 입력 사용
+        exit_code = search_file("-", &matcher, &opts, 0, stdout, NULL);
+    } else if (file_count == 1 || opts.threads == 1) {
+        // 파일이 하나뿐이거나 -j 1 이면 순서대로 바로 출력
+        for (i = 0; i < file_count; i++) {
+            int result = search_file(files[i], &matcher, &opts, file_count > 1, stdout, NULL);
             
             if (result == 0) {
                 exit_code = 0; // 매칭 발견
+                
+                // -q 는 첫 매치에서 바로 끝낸다
+                if (opts.mode == OUTPUT_QUIET) {
+                    break;
+                }
             } else if (result == 2) {
                 exit_code = 2; // 에러 발생
             }
         }
+    } else {
+        exit_code = search_files_parallel(files, file_count, &matcher, &opts);
     }
     
+    matcher_free(&matcher);
+    free_patterns(&opts);
+    free(files);
     return exit_code;
-} 
\ No newline at end of file
+}
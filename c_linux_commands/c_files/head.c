@@ -1,56 +1,177 @@
+#define _GNU_SOURCE
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/sendfile.h>
 
-int head_file(const char* filename, int num_lines) {
-    FILE* file = fopen(filename, "r");
-    if (!file) {
-        perror("head");
-        return 1;
+#define HEAD_BLOCK_SIZE (128 * 1024)    // -n 에서 한 번에 읽는 블록 크기
+
+static char block[HEAD_BLOCK_SIZE];
+
+int write_all(const char* data, size_t len) {
+    while (len > 0) {
+        ssize_t n = write(STDOUT_FILENO, data, len);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+        data += n;
+        len -= n;
     }
+    return 0;
+}
+
+// 커널 복사가 이 조합을 지원하지 않는다는 뜻의 오류인지
+static int unsupported(int err) {
+    return err == EINVAL || err == ENOSYS || err == EXDEV || err == EOPNOTSUPP ||
+           err == EBADF || err == ESPIPE;
+}
+
+// -c: 앞의 num_bytes 바이트만 보낸다. 일반 파일이면 copy_file_range/sendfile 로
+// 커널 안에서 옮기고, 그 밖에는 남은 만큼만 read 해서 더 읽지 않는다.
+int head_bytes(int fd, long long num_bytes) {
+    struct stat in_st, out_st;
+    long long remaining = num_bytes;
     
-    char* line = NULL;
-    size_t len = 0;
-    int count = 0;
-    
-    while (count < num_lines && getline(&line, &len, file) != -1) {
-        printf("%s", line);
-        count++;
+    if (fstat(fd, &in_st) == 0 && fstat(STDOUT_FILENO, &out_st) == 0 && S_ISREG(in_st.st_mode)) {
+        int same_kind = S_ISREG(out_st.st_mode);
+        while (remaining > 0) {
+            ssize_t n = same_kind ? copy_file_range(fd, NULL, STDOUT_FILENO, NULL, remaining, 0)
+                                  : sendfile(STDOUT_FILENO, fd, NULL, remaining);
+            if (n > 0) {
+                remaining -= n;
+                continue;
+            }
+            if (n == 0) {
+                return 0;
+            }
+            if (errno == EINTR) {
+                continue;
+            }
+            if (!unsupported(errno)) {
+                return -1;
+            }
+            break;
+        }
     }
     
-    free(line);
-    fclose(file);
+    while (remaining > 0) {
+        size_t want = remaining < HEAD_BLOCK_SIZE ? (size_t)remaining : HEAD_BLOCK_SIZE;
+        ssize_t n = read(fd, block, want);
+        if (n == 0) {
+            break;
+        }
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+        if (write_all(block, n) != 0) {
+            return -1;
+        }
+        remaining -= n;
+    }
     return 0;
 }
 
-int head_stdin(int num_lines) {
-    char* line = NULL;
-    size_t len = 0;
-    int count = 0;
+// -n: 블록을 읽어 memchr 로 줄바꿈을 세다가 num_lines 번째에서 멈춘다.
+// 줄마다 복사하지 않고 블록에서 바로 내보내며, 되감을 수 있는 입력이면
+// 읽고 남은 부분만큼 위치를 돌려놓아 뒤따르는 프로그램이 이어 읽게 한다.
+int head_lines(int fd, long long num_lines) {
+    long long count = 0;
     
-    while (count < num_lines && getline(&line, &len, stdin) != -1) {
-        printf("%s", line);
-        count++;
+    while (count < num_lines) {
+        ssize_t n = read(fd, block, sizeof(block));
+        if (n == 0) {
+            break;
+        }
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+        
+        const char* p = block;
+        const char* end = block + n;
+        while (count < num_lines) {
+            const char* newline = memchr(p, '\n', end - p);
+            if (!newline) {
+                p = end;
+                break;
+            }
+            p = newline + 1;
+            count++;
+        }
+        
+        if (write_all(block, p - block) != 0) {
+            return -1;
+        }
+        if (p < end) {
+            lseek(fd, -(off_t)(end - p), SEEK_CUR);    // 파이프면 실패해도 상관없다
+        }
+    }
+    return 0;
+}
+
+int head_fd(int fd, long long count, int byte_mode) {
+    // 머리글은 stdio 로 찍으므로 write 전에 비워 둔다
+    fflush(stdout);
+    return byte_mode ? head_bytes(fd, count) : head_lines(fd, count);
+}
+
+int head_file(const char* filename, long long count, int byte_mode) {
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) {
+        perror("head");
+        return 1;
     }
     
-    free(line);
+    int result = head_fd(fd, count, byte_mode);
+    if (result != 0) {
+        perror("head");
+    }
+    close(fd);
+    return result != 0;
+}
+
+int head_stdin(long long count, int byte_mode) {
+    if (head_fd(STDIN_FILENO, count, byte_mode) != 0) {
+        perror("head");
+        return 1;
+    }
     return 0;
 }
 
 int main(int argc, char* argv[]) {
-    int num_lines = 10;
+    long long count = 10;
+    int byte_mode = 0;
     int start_idx = 1;
     
-    if (argc > 2 && strcmp(argv[1], "-n") == 0) {
-        num_lines = atoi(argv[2]);
-        if (num_lines <= 0) {
-            num_lines = 10;
+    if (argc > 2 && (strcmp(argv[1], "-n") == 0 || strcmp(argv[1], "-c") == 0)) {
+        char* end;
+        byte_mode = argv[1][1] == 'c';
+        count = strtoll(argv[2], &end, 10);
+        if (byte_mode) {
+            if (end == argv[2] || *end != '\0' || count < 0) {
+                fprintf(stderr, "head: 잘못된 바이트 수: %s\n", argv[2]);
+                return 1;
+            }
+        } else if (count <= 0) {
+            count = 10;
         }
         start_idx = 3;
     }
     
     if (argc < start_idx + 1) {
-        return head_stdin(num_lines);
+        return head_stdin(count, byte_mode);
     }
     
     for (int i = start_idx; i < argc; i++) {
@@ -58,7 +179,7 @@ int main(int argc, char* argv[]) {
             printf("==> %s <==\n", argv[i]);
         }
         
-        if (head_file(argv[i], num_lines) != 0) {
+        if (head_file(argv[i], count, byte_mode) != 0) {
             return 1;
         }
         
@@ -68,4 +189,4 @@ int main(int argc, char* argv[]) {
     }
     
     return 0;
-} 
\ No newline at end of file
+}
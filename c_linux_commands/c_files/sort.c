@@ -1,250 +1,1428 @@
+#define _GNU_SOURCE
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <stdint.h>
+#include <ctype.h>
 #include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <pthread.h>
+
+#define SORT_DEFAULT_MEMORY (256L * 1024 * 1024)   // -S 기본값
+#define SORT_MERGE_MAX 64                          // 한 번에 병합하는 최대 런 수
+#define SORT_PARALLEL_MIN 65536                    // 이보다 줄이 적으면 스레드를 쓰지 않는다
+#define SORT_THREADS_MAX 64                        // --parallel 상한
+#define SORT_BLOCK_SIZE (1024 * 1024)              // 입력을 읽어 들이는 아레나 블록 크기
+#define SORT_RADIX_MIN 32                          // 이보다 작은 묶음은 삽입 정렬
+#define SORT_KEY_CHUNK 65536                       // 줄별 키를 담는 묶음 하나의 키 수
+#define SORT_NO_FIELD ((size_t)-1)                 // -k 에 끝 필드가 없음 (줄 끝까지)
+
+// -k 옵션 하나: 필드와 글자 위치는 0부터 센다
+typedef struct {
+    size_t start_field;
+    size_t start_char;
+    size_t end_field;       // SORT_NO_FIELD 면 줄 끝까지
+    size_t end_char;        // 0 이면 끝 필드의 끝까지
+    int skip_start_blanks;  // b: 시작 위치에서 공백 건너뛰기
+    int skip_end_blanks;    // 끝 위치에 b
+    int numeric;            // n
+    int human;              // h: 2K, 1G 같은 단위 붙은 숫자
+    int reverse;            // r
+} key_spec;
 
 typedef struct {
-    int reverse;  // -r 옵션
+    int reverse;            // -r 옵션
+    size_t memory_limit;    // -S 옵션: 한 런이 쓸 수 있는 최대 메모리
+    const char* temp_dir;   // -T 옵션: 런을 내려 쓸 디렉토리
+    int threads;            // --parallel 옵션: 메모리 안 정렬에 쓰는 스레드 수
+    int tab;                // -t 옵션: 필드 구분 문자, -1 이면 공백과 공백 아닌 문자 사이
+    int numeric;            // -n 옵션
+    int human;              // -h 옵션
+    int skip_blanks;        // -b 옵션
+    int unique;             // -u 옵션: 키가 같은 줄은 처음 것만 출력
+    int merge_only;         // -m 옵션: 이미 정렬된 입력들을 병합만 한다
+    key_spec* keys;         // -k 옵션들 (없으면 줄 전체를 바이트 순서로 비교)
+    int key_count;
 } sort_options;
 
-// 정순 비교 함수
-int compare_asc(const void* a, const void* b) {
-    return strcmp(*(const char**)a, *(const char**)b);
+// 줄마다 한 번 뽑아 둔 키 (위치는 줄 안의 오프셋)
+// 문자 키는 [start, start + len) 범위, 숫자 키는 앞의 0을 뺀 정수부 숫자와 뒤의 0을 뺀 소수부 숫자
+typedef struct {
+    uint32_t start;
+    uint32_t len;
+    uint32_t frac;
+    uint32_t frac_len;
+    int8_t sign;            // 숫자 키의 부호 (-1, 0, 1)
+    int8_t unit;            // -h 의 단위 순서 (K = 1, M = 2, ..., 음수면 부호가 뒤집힘)
+} sort_key;
+
+// 아레나 블록 안의 한 줄 (개행 문자는 빼고 길이로 끝을 안다)
+// prefix 는 줄 앞 8바이트를 빅엔디안으로 담아 둔 것이라 정수 비교가 곧 바이트 순서 비교다.
+// 키로 정렬할 때는 첫 키에서 같은 성질의 값을 만들어 둔다. 대부분의 비교는 text 를 따라가지 않고 prefix 에서 끝난다
+typedef struct {
+    const char* text;
+    size_t len;
+    uint64_t prefix;
+    const sort_key* keys;   // -k 키들 (키가 없으면 NULL)
+} sort_line;
+
+// 메모리에 올라와 있는 줄들 (런 하나)
+// 줄 내용은 입력을 그대로 읽어 들인 큰 블록들에 있고 lines 는 그 안을 가리키기만 한다
+typedef struct {
+    sort_line* lines;
+    size_t line_count;
+    size_t capacity;
+    char** blocks;          // 아레나 블록들, 마지막 것에 이어서 읽는다
+    int block_count;
+    int block_capacity;
+    size_t block_size;      // 마지막 블록의 크기와 채워진 바이트 수
+    size_t block_used;
+    sort_key** key_chunks;  // 줄별 키 묶음들 (한 번 잡으면 옮기지 않는다)
+    int key_chunk_count;
+    int key_chunk_capacity;
+    size_t key_chunk_used;  // 마지막 묶음에서 쓴 키 수
+    size_t bytes;           // 블록 + 줄 배열(정렬 작업 공간 몫까지 두 배) + 키가 차지하는 메모리
+} sort_run;
+
+// 디스크에 내려 쓴 정렬된 런들
+typedef struct {
+    FILE** files;
+    int* levels;            // 몇 번 병합을 거친 런인지 (0 = 메모리에서 바로 내려 쓴 런)
+    int count;
+    int capacity;
+} run_list;
+
+// 바이트 단위 비교 (LC_ALL=C 의 strcmp 와 같은 순서, 줄 안의 NUL 도 비교한다)
+int line_cmp(const char* a, size_t alen, const char* b, size_t blen) {
+    int cmp = memcmp(a, b, alen < blen ? alen : blen);
+    if (cmp != 0) {
+        return cmp;
+    }
+    return (alen > blen) - (alen < blen);
 }
 
-// 역순 비교 함수
-int compare_desc(const void* a, const void* b) {
-    return strcmp(*(const char**)b, *(const char**)a);
+// 줄 앞 8바이트 (모자라면 0으로 채움)
+uint64_t line_prefix(const char* text, size_t len) {
+    uint64_t prefix = 0;
+    
+    if (len >= 8) {
+        memcpy(&prefix, text, 8);
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+        prefix = __builtin_bswap64(prefix);
+#endif
+        return prefix;
+    }
+    for (size_t i = 0; i < len; i++) {
+        prefix |= (uint64_t)(unsigned char)text[i] << (56 - 8 * i);
+    }
+    return prefix;
 }
 
-int sort_file(const char* filename, sort_options* opts) {
-    FILE* file;
-    char** lines = NULL;
-    char buffer[4096];
-    int line_count = 0;
-    int capacity = 100;
-    
-    // 파일 열기
-    if (strcmp(filename, "-") == 0) {
-        file = stdin;
+// 줄 전체를 바이트 순서로 비교한다
+// prefix 가 다르면 그 순서가 곧 줄 순서다 (짧은 줄의 0 채움은 더 긴 줄의 어떤 바이트보다도 작거나 같다)
+int compare_asc(const sort_line* a, const sort_line* b) {
+    if (a->prefix != b->prefix) {
+        return a->prefix < b->prefix ? -1 : 1;
+    }
+    return line_cmp(a->text, a->len, b->text, b->len);
+}
+
+static inline int is_blank(char c) {
+    return c == ' ' || c == '\t';
+}
+
+// 필드 구분: -t 가 없으면 공백이 아닌 문자 뒤에 오는 공백에서 필드가 나뉜다 (앞 공백은 필드에 포함)
+const char* skip_fields(const char* p, const char* lim, size_t count, int tab, int stop_before_tab) {
+    while (p < lim && count--) {
+        if (tab >= 0) {
+            while (p < lim && *p != (char)tab) {
+                p++;
+            }
+            if (p < lim && (count > 0 || !stop_before_tab)) {
+                p++;
+            }
+        } else {
+            while (p < lim && is_blank(*p)) {
+                p++;
+            }
+            while (p < lim && !is_blank(*p)) {
+                p++;
+            }
+        }
+    }
+    return p;
+}
+
+// -h 단위 순서
+int unit_order(char c) {
+    switch (c) {
+        case 'K': case 'k': return 1;
+        case 'M': return 2;
+        case 'G': return 3;
+        case 'T': return 4;
+        case 'P': return 5;
+        case 'E': return 6;
+        case 'Z': return 7;
+        case 'Y': return 8;
+        case 'R': return 9;
+        case 'Q': return 10;
+        default: return 0;
+    }
+}
+
+// [p, lim) 의 숫자를 부호, 정수부, 소수부로 나눠 둔다 (숫자가 아니면 0)
+void parse_number(const char* text, const char* p, const char* lim, int human, sort_key* key) {
+    while (p < lim && is_blank(*p)) {
+        p++;
+    }
+    int negative = p < lim && *p == '-';
+    if (negative) {
+        p++;
+    }
+    while (p < lim && *p == '0') {
+        p++;
+    }
+    
+    const char* digits = p;
+    while (p < lim && isdigit((unsigned char)*p)) {
+        p++;
+    }
+    key->start = digits - text;
+    key->len = p - digits;
+    key->frac = p - text;
+    key->frac_len = 0;
+    
+    if (p < lim && *p == '.') {
+        const char* frac = ++p;
+        while (p < lim && isdigit((unsigned char)*p)) {
+            p++;
+        }
+        const char* frac_end = p;
+        while (frac_end > frac && frac_end[-1] == '0') {
+            frac_end--;
+        }
+        key->frac = frac - text;
+        key->frac_len = frac_end - frac;
+    }
+    
+    key->sign = (key->len || key->frac_len) ? (negative ? -1 : 1) : 0;
+    key->unit = 0;
+    if (human && key->sign != 0 && p < lim) {
+        key->unit = negative ? -unit_order(*p) : unit_order(*p);
+    }
+}
+
+// 숫자 키 비교: 단위 (-h), 부호, 정수부 자릿수, 숫자 순서
+int number_cmp(const char* a, const sort_key* x, const char* b, const sort_key* y) {
+    if (x->unit != y->unit) {
+        return x->unit < y->unit ? -1 : 1;
+    }
+    if (x->sign != y->sign) {
+        return x->sign < y->sign ? -1 : 1;
+    }
+    
+    int cmp;
+    if (x->len != y->len) {
+        cmp = x->len < y->len ? -1 : 1;
     } else {
-        file = fopen(filename, "r");
-        if (!file) {
-            fprintf(stderr, "sort: %s: 파일을 열 수 없습니다\n", filename);
-            return 1;
+        cmp = memcmp(a + x->start, b + y->start, x->len);
+        if (cmp == 0) {
+            cmp = line_cmp(a + x->frac, x->frac_len, b + y->frac, y->frac_len);
         }
     }
+    return x->sign < 0 ? -cmp : cmp;
+}
+
+// 숫자 키의 순서를 지키는 8바이트 값: 단위 5비트, 부호 2비트, 정수부 자릿수 14비트, 앞 숫자 10개.
+// 음수는 크기 부분을 뒤집는다. 자릿수가 넘치면 숫자를 비워서 prefix 가 같게 만들고 전체 비교에 맡긴다
+uint64_t number_prefix(const char* text, const sort_key* key) {
+    uint64_t prefix = (uint64_t)(key->unit + 16) << 59 | (uint64_t)(key->sign + 1) << 57;
+    uint64_t magnitude = 0;
     
-    // 초기 메모리 할당
-    lines = malloc(capacity * sizeof(char*));
-    if (!lines) {
-        fprintf(stderr, "sort: 메모리 할당 실패\n");
-        if (file != stdin) fclose(file);
-        return 1;
+    if (key->len < (1 << 14) - 1) {
+        magnitude = (uint64_t)key->len << 40;
+        int shift = 36;
+        for (uint32_t i = 0; i < key->len && shift >= 0; i++, shift -= 4) {
+            magnitude |= (uint64_t)(text[key->start + i] - '0') << shift;
+        }
+        for (uint32_t i = 0; i < key->frac_len && shift >= 0; i++, shift -= 4) {
+            magnitude |= (uint64_t)(text[key->frac + i] - '0') << shift;
+        }
+    } else {
+        magnitude = (uint64_t)((1 << 14) - 1) << 40;
     }
     
-    // 파일을 줄 단위로 읽기
-    while (fgets(buffer, sizeof(buffer), file) != NULL) {
-        // 줄 끝의 개행 문자 제거
-        size_t len = strlen(buffer);
-        if (len > 0 && buffer[len-1] == '\n') {
-            buffer[len-1] = '\0';
+    if (key->sign < 0) {
+        magnitude = ~magnitude & ((1ULL << 54) - 1);
+    }
+    return prefix | magnitude;
+}
+
+// 줄에서 키들을 한 번에 뽑아 line->keys 에 채우고 prefix 를 정한다
+void line_parse(sort_line* line, sort_key* keys, const sort_options* opts) {
+    const char* lim = line->text + line->len;
+    
+    line->keys = opts->key_count ? keys : NULL;
+    if (opts->key_count == 0) {
+        line->prefix = line_prefix(line->text, line->len);
+        return;
+    }
+    
+    for (int i = 0; i < opts->key_count; i++) {
+        const key_spec* spec = &opts->keys[i];
+        
+        // 키 시작
+        const char* begin = skip_fields(line->text, lim, spec->start_field, opts->tab, 0);
+        if (spec->skip_start_blanks) {
+            while (begin < lim && is_blank(*begin)) {
+                begin++;
+            }
         }
+        begin = (size_t)(lim - begin) < spec->start_char ? lim : begin + spec->start_char;
         
-        // 메모리 부족시 확장
-        if (line_count >= capacity) {
-            capacity *= 2;
-            char** temp = realloc(lines, capacity * sizeof(char*));
-            if (!temp) {
-                fprintf(stderr, "sort: 메모리 할당 실패\n");
-                // 할당된 메모리 해제
-                for (int i = 0; i < line_count; i++) {
-                    free(lines[i]);
+        // 키 끝
+        const char* end = lim;
+        if (spec->end_field != SORT_NO_FIELD) {
+            size_t fields = spec->end_field + (spec->end_char == 0);
+            end = skip_fields(line->text, lim, fields, opts->tab, spec->end_char == 0);
+            if (spec->end_char != 0) {
+                if (spec->skip_end_blanks) {
+                    while (end < lim && is_blank(*end)) {
+                        end++;
+                    }
                 }
-                free(lines);
-                if (file != stdin) fclose(file);
-                return 1;
+                end = (size_t)(lim - end) < spec->end_char ? lim : end + spec->end_char;
             }
-            lines = temp;
+        }
+        if (end < begin) {
+            end = begin;
         }
         
-        // 줄 복사해서 저장
-        lines[line_count] = malloc(strlen(buffer) + 1);
-        if (!lines[line_count]) {
-            fprintf(stderr, "sort: 메모리 할당 실패\n");
-            // 할당된 메모리 해제
-            for (int i = 0; i < line_count; i++) {
-                free(lines[i]);
-            }
-            free(lines);
-            if (file != stdin) fclose(file);
-            return 1;
+        if (spec->numeric || spec->human) {
+            parse_number(line->text, begin, end, spec->human, &keys[i]);
+        } else {
+            keys[i].start = begin - line->text;
+            keys[i].len = end - begin;
         }
-        strcpy(lines[line_count], buffer);
-        line_count++;
     }
     
-    if (file != stdin) {
-        fclose(file);
+    const key_spec* first = &opts->keys[0];
+    if (first->numeric || first->human) {
+        line->prefix = number_prefix(line->text, &keys[0]);
+    } else {
+        line->prefix = line_prefix(line->text + keys[0].start, keys[0].len);
+    }
+}
+
+// 정렬 순서대로 비교한다: 키들을 차례로, 모두 같으면 줄 전체를 바이트 순서로 (-r 은 여기에만 걸린다)
+// -u 면 키만 비교하고, 키가 같은 줄은 안정 정렬로 입력 순서를 지켜 처음 것을 남긴다
+int compare_lines(const sort_line* a, const sort_line* b, const sort_options* opts) {
+    int cmp;
+    
+    if (opts->key_count == 0) {
+        cmp = compare_asc(a, b);
+        return opts->reverse ? -cmp : cmp;
     }
     
-    // 정렬 수행
-    if (line_count > 0) {
-        if (opts->reverse) {
-            qsort(lines, line_count, sizeof(char*), compare_desc);
+    for (int i = 0; i < opts->key_count; i++) {
+        const key_spec* spec = &opts->keys[i];
+        const sort_key* x = &a->keys[i];
+        const sort_key* y = &b->keys[i];
+        
+        if (i == 0 && a->prefix != b->prefix) {
+            cmp = a->prefix < b->prefix ? -1 : 1;
+        } else if (spec->numeric || spec->human) {
+            cmp = number_cmp(a->text, x, b->text, y);
         } else {
-            qsort(lines, line_count, sizeof(char*), compare_asc);
+            cmp = line_cmp(a->text + x->start, x->len, b->text + y->start, y->len);
+        }
+        if (cmp != 0) {
+            return spec->reverse ? -cmp : cmp;
+        }
+    }
+    if (opts->unique) {
+        return 0;
+    }
+    
+    cmp = line_cmp(a->text, a->len, b->text, b->len);
+    return opts->reverse ? -cmp : cmp;
+}
+
+// 줄 배열 한 칸이 예산에서 차지하는 크기: run_sort()/parallel_sort() 의 같은 크기 작업 공간까지 센다
+#define SORT_LINE_COST (2 * sizeof(sort_line))
+
+// 런을 비운다. 줄 배열은 다음 런에서도 그대로 쓰므로 계속 예산에 넣되,
+// 예산의 절반을 넘게 차지하면 다음 런이 너무 작아지므로 놓아 준다
+void run_clear(sort_run* run, size_t memory_limit) {
+    for (int i = 0; i < run->block_count; i++) {
+        free(run->blocks[i]);
+    }
+    for (int i = 0; i < run->key_chunk_count; i++) {
+        free(run->key_chunks[i]);
+    }
+    run->block_count = 0;
+    run->block_size = 0;
+    run->block_used = 0;
+    run->key_chunk_count = 0;
+    run->key_chunk_used = 0;
+    run->line_count = 0;
+    
+    if (run->capacity * SORT_LINE_COST > memory_limit / 2) {
+        free(run->lines);
+        run->lines = NULL;
+        run->capacity = 0;
+    }
+    run->bytes = run->capacity * SORT_LINE_COST;
+}
+
+// 줄 하나의 키 count 개 자리를 잡는다
+sort_key* run_alloc_keys(sort_run* run, int count) {
+    if (run->key_chunk_count == 0 || run->key_chunk_used + count > SORT_KEY_CHUNK) {
+        if (run->key_chunk_count >= run->key_chunk_capacity) {
+            int capacity = run->key_chunk_capacity ? run->key_chunk_capacity * 2 : 16;
+            sort_key** temp = realloc(run->key_chunks, capacity * sizeof(sort_key*));
+            if (!temp) {
+                return NULL;
+            }
+            run->key_chunks = temp;
+            run->key_chunk_capacity = capacity;
         }
         
-        // 정렬된 결과 출력
-        for (int i = 0; i < line_count; i++) {
-            printf("%s\n", lines[i]);
+        sort_key* chunk = malloc(SORT_KEY_CHUNK * sizeof(sort_key));
+        if (!chunk) {
+            return NULL;
         }
+        run->key_chunks[run->key_chunk_count++] = chunk;
+        run->key_chunk_used = 0;
+        run->bytes += SORT_KEY_CHUNK * sizeof(sort_key);
     }
     
-    // 메모리 해제
-    for (int i = 0; i < line_count; i++) {
-        free(lines[i]);
+    sort_key* keys = run->key_chunks[run->key_chunk_count - 1] + run->key_chunk_used;
+    run->key_chunk_used += count;
+    return keys;
+}
+
+// 줄 하나를 런에 기록한다 (실패하면 메시지를 출력하고 -1)
+int run_add(sort_run* run, const char* text, size_t len, const sort_options* opts) {
+    // 키 위치는 32비트 오프셋으로 담는다
+    if (opts->key_count > 0 && len > UINT32_MAX) {
+        fprintf(stderr, "sort: 키로 정렬하기에는 줄이 너무 깁니다\n");
+        return -1;
     }
-    free(lines);
     
+    // 메모리 부족시 확장 (-S 를 넘지 않게 남은 예산만큼만 늘린다)
+    if (run->line_count >= run->capacity) {
+        size_t capacity = run->capacity ? run->capacity * 2 : 1024;
+        size_t room = opts->memory_limit > run->bytes ?
+                      (opts->memory_limit - run->bytes) / SORT_LINE_COST : 0;
+        if (capacity > run->capacity + room) {
+            capacity = run->capacity + (room > 1024 ? room : 1024);
+        }
+        sort_line* temp = realloc(run->lines, capacity * sizeof(sort_line));
+        if (!temp) {
+            fprintf(stderr, "sort: 메모리 할당 실패\n");
+            return -1;
+        }
+        run->bytes += (capacity - run->capacity) * SORT_LINE_COST;
+        run->lines = temp;
+        run->capacity = capacity;
+    }
+    
+    sort_key* keys = NULL;
+    if (opts->key_count > 0) {
+        keys = run_alloc_keys(run, opts->key_count);
+        if (!keys) {
+            fprintf(stderr, "sort: 메모리 할당 실패\n");
+            return -1;
+        }
+    }
+    
+    sort_line* line = &run->lines[run->line_count++];
+    line->text = text;
+    line->len = len;
+    line_parse(line, keys, opts);
     return 0;
 }
 
-int main(int argc, char* argv[]) {
-    sort_options opts = {0};
-    int i;
-    int file_start_index = -1;
-    int exit_code = 0;
+// 새 아레나 블록을 붙인다. 앞쪽 used 바이트에는 앞 블록에서 끝나지 않은 줄 조각이 들어 있다
+int run_add_block(sort_run* run, char* block, size_t size, size_t used) {
+    if (run->block_count >= run->block_capacity) {
+        int capacity = run->block_capacity ? run->block_capacity * 2 : 16;
+        char** temp = realloc(run->blocks, capacity * sizeof(char*));
+        if (!temp) {
+            return -1;
+        }
+        run->blocks = temp;
+        run->block_capacity = capacity;
+    }
     
-    // 명령행 인수 파싱
-    for (i = 1; i < argc; i++) {
-        if (strcmp(argv[i], "-r") == 0) {
-            opts.reverse = 1;
-        } else if (argv[i][0] == '-') {
-            fprintf(stderr, "sort: 알 수 없는 옵션: %s\n", argv[i]);
-            return 2;
-        } else {
-            // 파일 시작 위치 기록
-            if (file_start_index == -1) {
-                file_start_index = i;
+    run->blocks[run->block_count++] = block;
+    run->block_size = size;
+    run->block_used = used;
+    run->bytes += size;
+    return 0;
+}
+
+// 병렬 정렬의 한 단계에서 스레드 하나가 맡는 일
+typedef struct {
+    sort_line* src;         // 이번 단계의 입력 (width 개씩 정렬된 구간들)
+    sort_line* dst;         // 이번 단계의 출력
+    size_t count;           // 전체 줄 수
+    size_t width;           // 이미 정렬된 구간의 길이 (0 이면 구간 정렬 단계)
+    size_t begin;           // 이 스레드가 채울 출력 범위 [begin, end)
+    size_t end;
+    const sort_options* opts;
+} sort_task;
+
+// 기수 정렬은 줄 전체나 문자열인 첫 키의 바이트로 나눈다 (숫자 첫 키는 비교 정렬)
+int radix_usable(const sort_options* opts) {
+    return opts->key_count == 0 || !(opts->keys[0].numeric || opts->keys[0].human);
+}
+
+static inline const char* radix_text(const sort_line* line) {
+    return line->keys ? line->text + line->keys[0].start : line->text;
+}
+
+static inline size_t radix_len(const sort_line* line) {
+    return line->keys ? line->keys[0].len : line->len;
+}
+
+// depth 바이트째 값으로 나눌 버킷 번호: 줄이 이미 끝났으면 0, 아니면 바이트 값 + 1
+// prefix 에는 depth 가 속한 8바이트 묶음이 들어 있다
+static inline int radix_key(const sort_line* line, size_t depth) {
+    if (depth >= radix_len(line)) {
+        return 0;
+    }
+    return (int)((line->prefix >> (56 - 8 * (depth % 8))) & 0xff) + 1;
+}
+
+// 앞 depth 바이트가 모두 같은 줄들을 삽입 정렬한다
+// 같은 묶음 안에서는 prefix 가 같은 위치의 8바이트를 담고 있으므로 compare_lines 의 prefix 비교도 그대로 맞다
+void insertion_sort(sort_line* lines, size_t count, size_t depth, const sort_options* opts) {
+    for (size_t i = 1; i < count; i++) {
+        sort_line line = lines[i];
+        size_t j = i;
+        
+        while (j > 0) {
+            const sort_line* prev = &lines[j - 1];
+            int cmp;
+            if (opts->key_count > 0) {
+                cmp = compare_lines(prev, &line, opts);
+            } else if (depth < 8) {
+                cmp = compare_asc(prev, &line);         // prefix 가 아직 줄 앞 8바이트다
+                cmp = opts->reverse ? -cmp : cmp;
+            } else {
+                cmp = line_cmp(prev->text + depth, prev->len - depth, line.text + depth, line.len - depth);
+                cmp = opts->reverse ? -cmp : cmp;
             }
+            if (cmp <= 0) {
+                break;
+            }
+            lines[j] = lines[j - 1];
+            j--;
         }
+        lines[j] = line;
+    }
+}
+
+// 미리 뽑아 둔 키로 비교하는 안정 병합 정렬 (temp 는 count 개 이상의 작업 공간)
+void merge_sort(sort_line* lines, sort_line* temp, size_t count, const sort_options* opts) {
+    if (count < SORT_RADIX_MIN) {
+        insertion_sort(lines, count, 0, opts);
+        return;
     }
     
-    // 파일이 지정되지 않은 경우 표준 입력 사용
-    if (file_start_index == -1) {
-        exit_code = sort_file("-", &opts);
-    } else {
-        // 여러 파일을 하나로 합쳐서 정렬
-        FILE* temp_file = tmpfile();
-        if (!temp_file) {
-            fprintf(stderr, "sort: 임시 파일 생성 실패\n");
-            return 1;
+    size_t mid = count / 2;
+    merge_sort(lines, temp, mid, opts);
+    merge_sort(lines + mid, temp, count - mid, opts);
+    if (compare_lines(&lines[mid - 1], &lines[mid], opts) <= 0) {
+        return;     // 이미 순서대로
+    }
+    
+    size_t i = 0, j = mid, k = 0;
+    while (i < mid && j < count) {
+        temp[k++] = compare_lines(&lines[j], &lines[i], opts) < 0 ? lines[j++] : lines[i++];
+    }
+    while (i < mid) {
+        temp[k++] = lines[i++];
+    }
+    memcpy(lines, temp, j * sizeof(sort_line));
+}
+
+// 첫 키가 모두 같은 줄들은 나머지 키와 줄 전체로 순서를 정한다
+void radix_ties(sort_line* lines, sort_line* temp, size_t count, const sort_options* opts) {
+    if (opts->key_count > 0 && count > 1) {
+        merge_sort(lines, temp, count, opts);
+    }
+}
+
+// 앞 depth 바이트가 모두 같은 줄들을 MSD 기수 정렬한다 (temp 는 count 개 이상의 작업 공간).
+// 8바이트를 다 쓰면 다음 8바이트를 prefix 에 다시 채우므로 바이트를 읽을 때 text 를 따라가는 일은
+// 8바이트에 한 번뿐이다. 가장 큰 버킷은 반복문으로 이어 가고 나머지만 재귀하므로 재귀 깊이는 log2(count) 이하다.
+// 버킷 분배는 안정적이라 같은 줄의 입력 순서가 유지되고, 끝나면 prefix 를 앞 8바이트로 되돌려 둔다.
+// 키가 있으면 첫 키의 바이트로 나누고, 첫 키가 같은 줄들만 radix_ties 로 마무리한다.
+void radix_sort(sort_line* lines, sort_line* temp, size_t count, size_t depth, const sort_options* opts) {
+    int reverse = opts->key_count > 0 ? opts->keys[0].reverse : opts->reverse;
+    sort_line* first = lines;
+    size_t first_count = count;
+    int reloaded = 0;
+    
+    while (count >= SORT_RADIX_MIN) {
+        if (depth % 8 == 0 && depth > 0) {
+            for (size_t i = 0; i < count; i++) {
+                sort_line* line = &lines[i];
+                size_t len = radix_len(line);
+                line->prefix = depth < len ? line_prefix(radix_text(line) + depth, len - depth) : 0;
+            }
+            reloaded = 1;
+        }
+        
+        size_t counts[257] = {0};
+        for (size_t i = 0; i < count; i++) {
+            counts[radix_key(&lines[i], depth)]++;
+        }
+        if (counts[0] == count) {
+            radix_ties(lines, temp, count, opts);   // 모두 여기서 끝나는 같은 키
+            count = 0;
+            break;
+        }
+        
+        // 버킷 시작 위치 (끝난 줄이 가장 작다, -r 이면 순서를 뒤집는다)
+        size_t starts[257];
+        size_t pos = 0;
+        for (int k = 0; k < 257; k++) {
+            int bucket = reverse ? (k == 256 ? 0 : 256 - k) : k;
+            starts[bucket] = pos;
+            pos += counts[bucket];
+        }
+        
+        int largest = 1;
+        for (int k = 1; k < 257; k++) {
+            if (counts[k] > counts[largest]) {
+                largest = k;
+            }
         }
         
-        // 모든 파일의 내용을 임시 파일에 복사
-        for (i = file_start_index; i < argc; i++) {
-            FILE* input_file;
-            char buffer[4096];
+        if (counts[largest] < count) {
+            size_t next[257];
+            memcpy(next, starts, sizeof(next));
+            for (size_t i = 0; i < count; i++) {
+                temp[next[radix_key(&lines[i], depth)]++] = lines[i];
+            }
+            memcpy(lines, temp, count * sizeof(sort_line));
             
-            if (strcmp(argv[i], "-") == 0) {
-                input_file = stdin;
-            } else {
-                input_file = fopen(argv[i], "r");
-                if (!input_file) {
-                    fprintf(stderr, "sort: %s: 파일을 열 수 없습니다\n", argv[i]);
-                    fclose(temp_file);
-                    return 1;
+            radix_ties(lines + starts[0], temp, counts[0], opts);
+            for (int k = 1; k < 257; k++) {
+                if (k != largest && counts[k] > 1) {
+                    radix_sort(lines + starts[k], temp, counts[k], depth + 1, opts);
                 }
             }
-            
-            while (fgets(buffer, sizeof(buffer), input_file) != NULL) {
-                fputs(buffer, temp_file);
+        }
+        
+        lines += starts[largest];
+        count = counts[largest];
+        depth++;
+    }
+    
+    if (count > 1) {
+        insertion_sort(lines, count, depth, opts);
+    }
+    
+    if (reloaded) {
+        for (size_t i = 0; i < first_count; i++) {
+            first[i].prefix = line_prefix(radix_text(&first[i]), radix_len(&first[i]));
+        }
+    }
+}
+
+// a, b 를 안정적으로 병합했을 때 앞의 k 개 중 a 에서 온 개수 (merge path)
+// 같은 줄이면 a 쪽이 먼저 나가므로 a[i - 1] <= b[k - i] 이고 b[k - i - 1] < a[i] 인 i 를 찾는다
+size_t merge_split(const sort_line* a, size_t na, const sort_line* b, size_t nb, size_t k, const sort_options* opts) {
+    size_t low = k > nb ? k - nb : 0;
+    size_t high = k < na ? k : na;
+    
+    while (low < high) {
+        size_t i = low + (high - low) / 2;
+        if (compare_lines(&a[i], &b[k - i - 1], opts) <= 0) {
+            low = i + 1;
+        } else {
+            high = i;
+        }
+    }
+    return low;
+}
+
+// 출력 범위 [begin, end) 에 걸친 구간 쌍들을 병합한다
+void merge_range(const sort_task* task) {
+    size_t pos = task->begin;
+    
+    while (pos < task->end) {
+        // pos 가 속한 구간 쌍 [pair, pair + 2 * width)
+        size_t pair = pos - pos % (2 * task->width);
+        size_t mid = pair + task->width < task->count ? pair + task->width : task->count;
+        size_t stop = pair + 2 * task->width < task->count ? pair + 2 * task->width : task->count;
+        size_t last = stop < task->end ? stop : task->end;
+        const sort_line* a = task->src + pair;
+        const sort_line* b = task->src + mid;
+        size_t na = mid - pair;
+        size_t nb = stop - mid;
+        
+        size_t i = merge_split(a, na, b, nb, pos - pair, task->opts);
+        size_t j = pos - pair - i;
+        while (pos < last) {
+            if (j >= nb || (i < na && compare_lines(&a[i], &b[j], task->opts) <= 0)) {
+                task->dst[pos++] = a[i++];
+            } else {
+                task->dst[pos++] = b[j++];
             }
+        }
+    }
+}
+
+void* sort_worker(void* arg) {
+    sort_task* task = arg;
+    
+    if (task->width == 0 && radix_usable(task->opts)) {
+        radix_sort(task->src + task->begin, task->dst + task->begin, task->end - task->begin, 0, task->opts);
+    } else if (task->width == 0) {
+        merge_sort(task->src + task->begin, task->dst + task->begin, task->end - task->begin, task->opts);
+    } else {
+        merge_range(task);
+    }
+    return NULL;
+}
+
+// 스레드 threads 개로 한 단계를 실행한다. 스레드를 만들지 못하면 그 일은 직접 한다
+void run_tasks(sort_task* tasks, int threads) {
+    pthread_t tids[SORT_THREADS_MAX];
+    int started[SORT_THREADS_MAX];
+    
+    for (int t = 1; t < threads; t++) {
+        started[t] = pthread_create(&tids[t], NULL, sort_worker, &tasks[t]) == 0;
+        if (!started[t]) {
+            sort_worker(&tasks[t]);
+        }
+    }
+    sort_worker(&tasks[0]);
+    for (int t = 1; t < threads; t++) {
+        if (started[t]) {
+            pthread_join(tids[t], NULL);
+        }
+    }
+}
+
+// 줄 배열을 threads 개 구간으로 나눠 동시에 정렬한 뒤, 구간 쌍을 병합하는 단계를 반복한다.
+// 각 병합 단계는 출력 배열을 스레드 수만큼 똑같이 나누고 merge path 로 입력 위치를 찾으므로
+// 구간 수가 줄어도 모든 스레드가 일한다. 같은 줄은 항상 앞 구간 것이 먼저 나가므로 안정 정렬이다.
+int parallel_sort(sort_line* lines, size_t count, int threads, const sort_options* opts) {
+    sort_task tasks[SORT_THREADS_MAX];
+    size_t width = (count + threads - 1) / threads;
+    sort_line* buffer = malloc(count * sizeof(sort_line));
+    sort_line* src = lines;
+    sort_line* dst = buffer;
+    
+    if (!buffer) {
+        return -1;
+    }
+    
+    for (int t = 0; t < threads; t++) {
+        tasks[t].src = lines;
+        tasks[t].dst = buffer;
+        tasks[t].count = count;
+        tasks[t].width = 0;
+        tasks[t].begin = width * t < count ? width * t : count;
+        tasks[t].end = width * (t + 1) < count ? width * (t + 1) : count;
+        tasks[t].opts = opts;
+    }
+    run_tasks(tasks, threads);
+    
+    for (; width < count; width *= 2) {
+        for (int t = 0; t < threads; t++) {
+            tasks[t].src = src;
+            tasks[t].dst = dst;
+            tasks[t].width = width;
+            tasks[t].begin = count * t / threads;
+            tasks[t].end = count * (t + 1) / threads;
+        }
+        run_tasks(tasks, threads);
+        
+        sort_line* temp = src;
+        src = dst;
+        dst = temp;
+    }
+    
+    if (src != lines) {
+        memcpy(lines, src, count * sizeof(sort_line));
+    }
+    free(buffer);
+    return 0;
+}
+
+int run_sort(sort_run* run, const sort_options* opts) {
+    if (opts->threads > 1 && run->line_count >= SORT_PARALLEL_MIN &&
+        parallel_sort(run->lines, run->line_count, opts->threads, opts) == 0) {
+        return 0;
+    }
+    if (run->line_count < 2) {
+        return 0;
+    }
+    
+    // 한 스레드로 정렬: 줄 전체나 문자열 첫 키는 기수 정렬, 숫자 첫 키는 미리 뽑아 둔 키로 병합 정렬
+    sort_line* temp = malloc(run->line_count * sizeof(sort_line));
+    if (!temp) {
+        fprintf(stderr, "sort: 메모리 할당 실패\n");
+        return -1;
+    }
+    if (radix_usable(opts)) {
+        radix_sort(run->lines, temp, run->line_count, 0, opts);
+    } else {
+        merge_sort(run->lines, temp, run->line_count, opts);
+    }
+    free(temp);
+    return 0;
+}
+
+// 임시 파일은 만들자마자 unlink 해서 프로세스가 끝나면 자동으로 지워지게 한다
+FILE* create_temp_file(const sort_options* opts) {
+    size_t len = strlen(opts->temp_dir) + sizeof("/sortXXXXXX");
+    char* path = malloc(len);
+    if (!path) {
+        return NULL;
+    }
+    snprintf(path, len, "%s/sortXXXXXX", opts->temp_dir);
+    
+    int fd = mkstemp(path);
+    if (fd < 0) {
+        fprintf(stderr, "sort: %s: 임시 파일 생성 실패\n", opts->temp_dir);
+        free(path);
+        return NULL;
+    }
+    unlink(path);
+    free(path);
+    
+    FILE* file = fdopen(fd, "w+");
+    if (!file) {
+        close(fd);
+    }
+    return file;
+}
+
+int runs_add(run_list* runs, FILE* file, int level) {
+    if (runs->count >= runs->capacity) {
+        int capacity = runs->capacity ? runs->capacity * 2 : 16;
+        FILE** temp = realloc(runs->files, capacity * sizeof(FILE*));
+        if (!temp) {
+            return -1;
+        }
+        runs->files = temp;
+        
+        int* levels = realloc(runs->levels, capacity * sizeof(int));
+        if (!levels) {
+            return -1;
+        }
+        runs->levels = levels;
+        runs->capacity = capacity;
+    }
+    runs->files[runs->count] = file;
+    runs->levels[runs->count] = level;
+    runs->count++;
+    return 0;
+}
+
+// 정렬된 런을 줄마다 개행을 붙여 출력한다
+// -u 면 바로 앞에 쓴 줄과 키가 같은 줄은 건너뛴다
+void run_write(const sort_run* run, FILE* out, const sort_options* opts) {
+    for (size_t i = 0; i < run->line_count; i++) {
+        if (opts->unique && i > 0 && compare_lines(&run->lines[i - 1], &run->lines[i], opts) == 0) {
+            continue;
+        }
+        fwrite(run->lines[i].text, 1, run->lines[i].len, out);
+        putc('\n', out);
+    }
+}
+
+// 현재 런을 정렬해서 임시 파일로 내려 쓰고 메모리를 비운다
+int spill_run(sort_run* run, run_list* runs, const sort_options* opts) {
+    FILE* file = create_temp_file(opts);
+    if (!file) {
+        return -1;
+    }
+    
+    if (run_sort(run, opts) != 0) {
+        fclose(file);
+        return -1;
+    }
+    run_write(run, file, opts);
+    
+    if (fflush(file) != 0 || ferror(file)) {
+        fprintf(stderr, "sort: 임시 파일 쓰기 실패\n");
+        fclose(file);
+        return -1;
+    }
+    rewind(file);
+    
+    if (runs_add(runs, file, 0) != 0) {
+        fprintf(stderr, "sort: 메모리 할당 실패\n");
+        fclose(file);
+        return -1;
+    }
+    run_clear(run, opts->memory_limit);
+    return 0;
+}
+
+// k-way 병합에 쓰는 런별 읽기 상태
+typedef struct {
+    FILE* file;
+    char* line;
+    size_t size;
+    sort_line view;         // 지금 줄과 그 키
+    sort_key* keys;
+} merge_source;
+
+int merge_read(merge_source* src, const sort_options* opts) {
+    ssize_t len = getline(&src->line, &src->size, src->file);
+    if (len < 0) {
+        return 0;
+    }
+    if (len > 0 && src->line[len - 1] == '\n') {
+        len--;
+    }
+    src->view.text = src->line;
+    src->view.len = (size_t)len;
+    line_parse(&src->view, src->keys, opts);
+    return 1;
+}
+
+int merge_less(const merge_source* a, const merge_source* b, const sort_options* opts) {
+    int cmp = compare_lines(&a->view, &b->view, opts);
+    if (cmp == 0) {
+        return a < b;   // 같은 줄이면 앞선 런 것이 먼저 (안정 병합)
+    }
+    return cmp < 0;
+}
+
+void heap_sift_down(int* heap, int count, int i, const merge_source* src, const sort_options* opts) {
+    for (;;) {
+        int smallest = i;
+        int left = 2 * i + 1;
+        int right = left + 1;
+        
+        if (left < count && merge_less(&src[heap[left]], &src[heap[smallest]], opts)) {
+            smallest = left;
+        }
+        if (right < count && merge_less(&src[heap[right]], &src[heap[smallest]], opts)) {
+            smallest = right;
+        }
+        if (smallest == i) {
+            return;
+        }
+        
+        int temp = heap[i];
+        heap[i] = heap[smallest];
+        heap[smallest] = temp;
+        i = smallest;
+    }
+}
+
+// 정렬된 런 files[0..count) 를 최소 힙으로 병합해 out 에 쓴다
+// -u 면 마지막으로 쓴 줄을 src[count] 에 들고 있다가 키가 같은 줄을 건너뛴다.
+// 줄을 쓸 때 그 버퍼를 src[count] 와 맞바꾸므로 줄 복사는 없다
+int merge_files(FILE** files, int count, FILE* out, const sort_options* opts) {
+    merge_source* src = calloc(count + 1, sizeof(merge_source));
+    int* heap = malloc(count * sizeof(int));
+    sort_key* keys = malloc((size_t)(count + 1) * opts->key_count * sizeof(sort_key) + 1);
+    merge_source* last = NULL;
+    int heap_count = 0;
+    
+    if (!src || !heap || !keys) {
+        fprintf(stderr, "sort: 메모리 할당 실패\n");
+        free(src);
+        free(heap);
+        free(keys);
+        return -1;
+    }
+    
+    for (int i = 0; i <= count; i++) {
+        src[i].keys = keys + (size_t)i * opts->key_count;
+    }
+    for (int i = 0; i < count; i++) {
+        src[i].file = files[i];
+        if (merge_read(&src[i], opts)) {
+            heap[heap_count++] = i;
+        }
+    }
+    for (int i = heap_count / 2 - 1; i >= 0; i--) {
+        heap_sift_down(heap, heap_count, i, src, opts);
+    }
+    
+    // 가장 작은 줄을 내보내고 그 런에서 다음 줄을 읽는다
+    while (heap_count > 0) {
+        merge_source* top = &src[heap[0]];
+        if (!last || compare_lines(&last->view, &top->view, opts) != 0) {
+            fwrite(top->view.text, 1, top->view.len, out);
+            putc('\n', out);
             
-            if (input_file != stdin) {
-                fclose(input_file);
+            if (opts->unique) {
+                // 방금 쓴 줄을 src[count] 로 옮기고, 그 자리의 빈 버퍼로 다음 줄을 읽는다
+                merge_source written = *top;
+                last = &src[count];
+                top->line = last->line;
+                top->size = last->size;
+                top->keys = last->keys;
+                last->line = written.line;
+                last->size = written.size;
+                last->keys = written.keys;
+                last->view = written.view;
             }
         }
         
-        // 임시 파일을 처음부터 읽어서 정렬
-        rewind(temp_file);
-        
-        char** lines = NULL;
-        char buffer[4096];
-        int line_count = 0;
-        int capacity = 100;
+        if (!merge_read(top, opts)) {
+            heap[0] = heap[--heap_count];
+        }
+        heap_sift_down(heap, heap_count, 0, src, opts);
+    }
+    
+    for (int i = 0; i <= count; i++) {
+        free(src[i].line);
+    }
+    free(src);
+    free(heap);
+    free(keys);
+    return 0;
+}
+
+// 같은 단계의 런이 SORT_MERGE_MAX 개 모이면 한 단계 위의 런 하나로 병합한다.
+// 열린 임시 파일 수는 SORT_MERGE_MAX * 단계 수로 묶이고, 각 줄은 단계 수만큼만 다시 쓰인다.
+// 런 목록은 항상 단계가 내림차순이므로 끝의 SORT_MERGE_MAX 개만 보면 된다.
+int compact_runs(run_list* runs, const sort_options* opts) {
+    while (runs->count >= SORT_MERGE_MAX &&
+           runs->levels[runs->count - SORT_MERGE_MAX] == runs->levels[runs->count - 1]) {
+        int first = runs->count - SORT_MERGE_MAX;
+        FILE* merged = create_temp_file(opts);
+        if (!merged) {
+            return -1;
+        }
         
-        // 초기 메모리 할당
-        lines = malloc(capacity * sizeof(char*));
-        if (!lines) {
-            fprintf(stderr, "sort: 메모리 할당 실패\n");
-            fclose(temp_file);
-            return 1;
+        if (merge_files(runs->files + first, SORT_MERGE_MAX, merged, opts) != 0 ||
+            fflush(merged) != 0 || ferror(merged)) {
+            fprintf(stderr, "sort: 임시 파일 쓰기 실패\n");
+            fclose(merged);
+            return -1;
         }
+        rewind(merged);
         
-        // 임시 파일을 줄 단위로 읽기
-        while (fgets(buffer, sizeof(buffer), temp_file) != NULL) {
-            // 줄 끝의 개행 문자 제거
-            size_t len = strlen(buffer);
-            if (len > 0 && buffer[len-1] == '\n') {
-                buffer[len-1] = '\0';
+        for (int i = first; i < runs->count; i++) {
+            fclose(runs->files[i]);
+        }
+        runs->files[first] = merged;
+        runs->levels[first]++;
+        runs->count = first + 1;
+    }
+    return 0;
+}
+
+// fd 의 내용을 아레나 블록에 그대로 읽어 들이고 줄마다 (위치, 길이) 만 기록한다.
+// -S 한도를 넘으면 지금까지 읽은 줄을 정렬된 런으로 내려 쓰고, 끝나지 않은 줄 조각만 새 블록으로 옮긴다.
+int read_lines(int fd, const char* name, sort_run* run, run_list* runs, const sort_options* opts) {
+    size_t start = run->block_used;     // 마지막 블록에서 아직 끝나지 않은 줄의 시작
+    
+    for (;;) {
+        // 블록이 꽉 찼으면 새 블록으로 (긴 줄은 블록을 키워서 담는다)
+        if (run->block_used == run->block_size) {
+            size_t carry_len = run->block_used - start;
+            size_t size = carry_len * 2 > SORT_BLOCK_SIZE ? carry_len * 2 : SORT_BLOCK_SIZE;
+            char* block = malloc(size);
+            if (!block) {
+                fprintf(stderr, "sort: 메모리 할당 실패\n");
+                return -1;
             }
-            
-            // 메모리 부족시 확장
-            if (line_count >= capacity) {
-                capacity *= 2;
-                char** temp = realloc(lines, capacity * sizeof(char*));
-                if (!temp) {
-                    fprintf(stderr, "sort: 메모리 할당 실패\n");
-                    for (int j = 0; j < line_count; j++) {
-                        free(lines[j]);
-                    }
-                    free(lines);
-                    fclose(temp_file);
-                    return 1;
-                }
-                lines = temp;
+            if (carry_len > 0) {
+                memcpy(block, run->blocks[run->block_count - 1] + start, carry_len);
             }
-            
-            // 줄 복사해서 저장
-            lines[line_count] = malloc(strlen(buffer) + 1);
-            if (!lines[line_count]) {
+            if (run_add_block(run, block, size, carry_len) != 0) {
                 fprintf(stderr, "sort: 메모리 할당 실패\n");
-                for (int j = 0; j < line_count; j++) {
-                    free(lines[j]);
-                }
-                free(lines);
-                fclose(temp_file);
-                return 1;
+                free(block);
+                return -1;
+            }
+            start = 0;
+        }
+        
+        char* block = run->blocks[run->block_count - 1];
+        ssize_t n = read(fd, block + run->block_used, run->block_size - run->block_used);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
             }
-            strcpy(lines[line_count], buffer);
-            line_count++;
+            fprintf(stderr, "sort: %s: 읽기 오류\n", name);
+            return -1;
+        }
+        if (n == 0) {
+            break;
         }
         
-        fclose(temp_file);
+        // 이번에 읽은 부분에서 끝나는 줄들을 기록
+        char* p = block + run->block_used;
+        char* end = p + n;
+        char* newline;
+        while ((newline = memchr(p, '\n', end - p)) != NULL) {
+            if (run_add(run, block + start, newline - (block + start), opts) != 0) {
+                return -1;
+            }
+            p = newline + 1;
+            start = p - block;
+        }
+        run->block_used += n;
         
-        // 정렬 수행
-        if (line_count > 0) {
-            if (opts.reverse) {
-                qsort(lines, line_count, sizeof(char*), compare_desc);
-            } else {
-                qsort(lines, line_count, sizeof(char*), compare_asc);
+        if (run->bytes >= opts->memory_limit) {
+            // 끝나지 않은 줄 조각을 새 블록에 옮긴 뒤 런을 내려 쓴다
+            size_t carry_len = run->block_used - start;
+            size_t size = carry_len * 2 > SORT_BLOCK_SIZE ? carry_len * 2 : SORT_BLOCK_SIZE;
+            char* next = malloc(size);
+            if (!next) {
+                fprintf(stderr, "sort: 메모리 할당 실패\n");
+                return -1;
             }
+            memcpy(next, block + start, carry_len);
             
-            // 정렬된 결과 출력
-            for (int j = 0; j < line_count; j++) {
-                printf("%s\n", lines[j]);
+            if (spill_run(run, runs, opts) != 0 || compact_runs(runs, opts) != 0 ||
+                run_add_block(run, next, size, carry_len) != 0) {
+                free(next);
+                return -1;
             }
+            start = 0;
+        }
+    }
+    
+    // 개행 없이 끝난 마지막 줄
+    if (start < run->block_used) {
+        char* block = run->blocks[run->block_count - 1];
+        if (run_add(run, block + start, run->block_used - start, opts) != 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+// 입력 파일들을 모두 읽어 하나로 정렬해서 출력한다 ("-" 는 표준 입력)
+int sort_files(char** files, int count, const sort_options* opts) {
+    sort_run run = {0};
+    run_list runs = {0};
+    int ret = 0;
+    
+    for (int i = 0; i < count && ret == 0; i++) {
+        int fd = 0;
+        
+        // 파일 열기
+        if (strcmp(files[i], "-") != 0) {
+            fd = open(files[i], O_RDONLY);
+            if (fd < 0) {
+                fprintf(stderr, "sort: %s: 파일을 열 수 없습니다\n", files[i]);
+                ret = 1;
+                break;
+            }
+        }
+        
+        if (read_lines(fd, files[i], &run, &runs, opts) != 0) {
+            ret = 1;
         }
         
-        // 메모리 해제
-        for (int j = 0; j < line_count; j++) {
-            free(lines[j]);
+        if (fd != 0) {
+            close(fd);
+        }
+    }
+    
+    if (ret == 0) {
+        if (runs.count == 0) {
+            // 메모리 안에서 끝나는 경우: 정렬된 결과 출력
+            if (run_sort(&run, opts) != 0) {
+                ret = 1;
+            } else {
+                run_write(&run, stdout, opts);
+            }
+        } else if ((run.line_count > 0 && spill_run(&run, &runs, opts) != 0) ||
+                   merge_files(runs.files, runs.count, stdout, opts) != 0) {
+            ret = 1;
+        }
+    }
+    
+    // 메모리 해제
+    run_clear(&run, opts->memory_limit);
+    free(run.lines);
+    free(run.blocks);
+    free(run.key_chunks);
+    for (int i = 0; i < runs.count; i++) {
+        fclose(runs.files[i]);
+    }
+    free(runs.files);
+    free(runs.levels);
+    
+    return ret;
+}
+
+// -m: 이미 정렬된 입력들을 다시 정렬하지 않고 바로 k-way 병합한다
+int merge_inputs(char** files, int count, const sort_options* opts) {
+    FILE** inputs = calloc(count, sizeof(FILE*));
+    int ret = 0;
+    
+    if (!inputs) {
+        fprintf(stderr, "sort: 메모리 할당 실패\n");
+        return 1;
+    }
+    
+    for (int i = 0; i < count; i++) {
+        if (strcmp(files[i], "-") == 0) {
+            inputs[i] = stdin;
+        } else {
+            inputs[i] = fopen(files[i], "r");
+            if (!inputs[i]) {
+                fprintf(stderr, "sort: %s: 파일을 열 수 없습니다\n", files[i]);
+                ret = 1;
+                break;
+            }
+        }
+    }
+    
+    if (ret == 0 && merge_files(inputs, count, stdout, opts) != 0) {
+        ret = 1;
+    }
+    
+    for (int i = 0; i < count; i++) {
+        if (inputs[i] && inputs[i] != stdin) {
+            fclose(inputs[i]);
+        }
+    }
+    free(inputs);
+    return ret;
+}
+
+// -S 크기: 숫자 뒤에 b, K, M, G, T 를 붙일 수 있고 단위가 없으면 KiB (GNU sort와 같음)
+int parse_size(const char* text, size_t* size) {
+    char* end;
+    unsigned long long value = strtoull(text, &end, 10);
+    unsigned long long unit = 1024;
+    
+    if (end == text) {
+        return -1;
+    }
+    
+    switch (toupper((unsigned char)*end)) {
+        case '\0': unit = 1024; break;
+        case 'B': unit = 1; end++; break;
+        case 'K': unit = 1024ULL; end++; break;
+        case 'M': unit = 1024ULL * 1024; end++; break;
+        case 'G': unit = 1024ULL * 1024 * 1024; end++; break;
+        case 'T': unit = 1024ULL * 1024 * 1024 * 1024; end++; break;
+        default: return -1;
+    }
+    
+    if (*end != '\0' || value == 0) {
+        return -1;
+    }
+    *size = (size_t)(value * unit);
+    return 0;
+}
+
+// -k 의 필드 번호나 글자 위치 (숫자가 없으면 -1)
+int parse_position(const char** text, size_t* value) {
+    const char* p = *text;
+    *value = 0;
+    
+    if (!isdigit((unsigned char)*p)) {
+        return -1;
+    }
+    while (isdigit((unsigned char)*p)) {
+        *value = *value * 10 + (*p++ - '0');
+    }
+    *text = p;
+    return 0;
+}
+
+// -k 뒤의 수식자들 (b, n, h, r)
+const char* parse_key_flags(const char* p, key_spec* key, int* skip_blanks) {
+    for (;; p++) {
+        switch (*p) {
+            case 'b': *skip_blanks = 1; break;
+            case 'n': key->numeric = 1; break;
+            case 'h': key->human = 1; break;
+            case 'r': key->reverse = 1; break;
+            default: return p;
+        }
+    }
+}
+
+// -k 시작[,끝] 형식: 필드[.글자][수식자] (필드와 시작 글자는 1부터, 끝 글자 0은 필드 끝까지)
+int parse_key(const char* text, key_spec* key) {
+    const char* p = text;
+    size_t value;
+    
+    memset(key, 0, sizeof(*key));
+    if (parse_position(&p, &value) != 0 || value == 0) {
+        return -1;
+    }
+    key->start_field = value - 1;
+    if (*p == '.') {
+        p++;
+        if (parse_position(&p, &value) != 0 || value == 0) {
+            return -1;
+        }
+        key->start_char = value - 1;
+    }
+    p = parse_key_flags(p, key, &key->skip_start_blanks);
+    
+    key->end_field = SORT_NO_FIELD;
+    if (*p == ',') {
+        p++;
+        if (parse_position(&p, &value) != 0 || value == 0) {
+            return -1;
+        }
+        key->end_field = value - 1;
+        if (*p == '.') {
+            p++;
+            if (parse_position(&p, &key->end_char) != 0) {
+                return -1;
+            }
+        }
+        p = parse_key_flags(p, key, &key->skip_end_blanks);
+    }
+    
+    return *p == '\0' ? 0 : -1;
+}
+
+int main(int argc, char* argv[]) {
+    sort_options opts = {0};
+    int i;
+    char** files = malloc(argc * sizeof(char*));
+    key_spec* keys = malloc((argc + 1) * sizeof(key_spec));
+    int file_count = 0;
+    int exit_code = 0;
+    
+    if (!files || !keys) {
+        fprintf(stderr, "sort: 메모리 할당 실패\n");
+        free(files);
+        free(keys);
+        return 1;
+    }
+    
+    opts.memory_limit = SORT_DEFAULT_MEMORY;
+    opts.threads = 1;
+    opts.tab = -1;
+    opts.keys = keys;
+    opts.temp_dir = getenv("TMPDIR") ? getenv("TMPDIR") : "/tmp";
+    
+    // 명령행 인수 파싱
+    for (i = 1; i < argc; i++) {
+        if (argv[i][0] == '-' && argv[i][1] != '\0' && strspn(argv[i] + 1, "rnhbum") == strlen(argv[i] + 1)) {
+            // -r, -n, -h, -b, -u, -m 과 그 조합 (-rn 등)
+            for (const char* flag = argv[i] + 1; *flag; flag++) {
+                switch (*flag) {
+                    case 'r': opts.reverse = 1; break;
+                    case 'n': opts.numeric = 1; break;
+                    case 'h': opts.human = 1; break;
+                    case 'b': opts.skip_blanks = 1; break;
+                    case 'u': opts.unique = 1; break;
+                    case 'm': opts.merge_only = 1; break;
+                }
+            }
+        } else if (strncmp(argv[i], "-t", 2) == 0) {
+            const char* value = argv[i][2] ? argv[i] + 2 : (i + 1 < argc ? argv[++i] : NULL);
+            if (!value || value[0] == '\0' || value[1] != '\0') {
+                fprintf(stderr, "sort: -t 옵션에는 구분 문자 하나가 필요합니다\n");
+                free(files);
+                free(keys);
+                return 2;
+            }
+            opts.tab = (unsigned char)value[0];
+        } else if (strncmp(argv[i], "-k", 2) == 0) {
+            const char* value = argv[i][2] ? argv[i] + 2 : (i + 1 < argc ? argv[++i] : NULL);
+            if (!value || parse_key(value, &keys[opts.key_count]) != 0) {
+                fprintf(stderr, "sort: 잘못된 키 지정: %s\n", value ? value : "");
+                free(files);
+                free(keys);
+                return 2;
+            }
+            opts.key_count++;
+        } else if (strncmp(argv[i], "-S", 2) == 0) {
+            const char* value = argv[i][2] ? argv[i] + 2 : (i + 1 < argc ? argv[++i] : NULL);
+            if (!value || parse_size(value, &opts.memory_limit) != 0) {
+                fprintf(stderr, "sort: 잘못된 메모리 크기: %s\n", value ? value : "");
+                free(files);
+                free(keys);
+                return 2;
+            }
+        } else if (strncmp(argv[i], "--parallel=", 11) == 0) {
+            char* end;
+            long threads = strtol(argv[i] + 11, &end, 10);
+            if (end == argv[i] + 11 || *end != '\0' || threads < 1) {
+                fprintf(stderr, "sort: 잘못된 스레드 수: %s\n", argv[i] + 11);
+                free(files);
+                free(keys);
+                return 2;
+            }
+            opts.threads = threads < SORT_THREADS_MAX ? (int)threads : SORT_THREADS_MAX;
+        } else if (strncmp(argv[i], "-T", 2) == 0) {
+            const char* value = argv[i][2] ? argv[i] + 2 : (i + 1 < argc ? argv[++i] : NULL);
+            if (!value) {
+                fprintf(stderr, "sort: -T 옵션에는 디렉토리가 필요합니다\n");
+                free(files);
+                free(keys);
+                return 2;
+            }
+            opts.temp_dir = value;
+        } else if (argv[i][0] == '-' && argv[i][1] != '\0') {
+            fprintf(stderr, "sort: 알 수 없는 옵션: %s\n", argv[i]);
+            free(files);
+            free(keys);
+            return 2;
+        } else {
+            files[file_count++] = argv[i];
+        }
+    }
+    
+    // 수식자가 없는 키는 전역 -n, -h, -b, -r 을 따른다
+    for (i = 0; i < opts.key_count; i++) {
+        key_spec* key = &keys[i];
+        if (!key->numeric && !key->human && !key->reverse && !key->skip_start_blanks && !key->skip_end_blanks) {
+            key->numeric = opts.numeric;
+            key->human = opts.human;
+            key->reverse = opts.reverse;
+            key->skip_start_blanks = opts.skip_blanks;
+            key->skip_end_blanks = opts.skip_blanks;
+        }
+    }
+    
+    // -k 없이 -n, -h, -b 만 있으면 줄 전체를 키 하나로 본다
+    if (opts.key_count == 0 && (opts.numeric || opts.human || opts.skip_blanks)) {
+        memset(&keys[0], 0, sizeof(key_spec));
+        keys[0].end_field = SORT_NO_FIELD;
+        keys[0].numeric = opts.numeric;
+        keys[0].human = opts.human;
+        keys[0].reverse = opts.reverse;
+        keys[0].skip_start_blanks = opts.skip_blanks;
+        keys[0].skip_end_blanks = opts.skip_blanks;
+        opts.key_count = 1;
+    }
+    
+    for (i = 0; i < opts.key_count; i++) {
+        if (keys[i].numeric && keys[i].human) {
+            fprintf(stderr, "sort: -n 과 -h 는 함께 쓸 수 없습니다\n");
+            free(files);
+            free(keys);
+            return 2;
         }
-        free(lines);
     }
     
+    // 파일이 지정되지 않은 경우 표준 입력 사용
+    if (file_count == 0) {
+        files[file_count++] = "-";
+    }
+    if (opts.merge_only) {
+        exit_code = merge_inputs(files, file_count, &opts);
+    } else {
+        exit_code = sort_files(files, file_count, &opts);
+    }
+    free(files);
+    free(keys);
+    
     return exit_code;
-} 
\ No newline at end of file
+}
@@ -1,6 +1,25 @@
+#define _GNU_SOURCE
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/sendfile.h>
+#include <sys/inotify.h>
+#include <sys/epoll.h>
+#include <libgen.h>
+
+#define TAIL_BLOCK_SIZE (64 * 1024)     // 끝에서부터 거꾸로 읽는 블록 크기
+#define TAIL_SEND_CHUNK (1L << 30)      // -f 에서 sendfile 한 번에 넘기는 최대 크기
+
+// -f 에서 파일마다 기다리는 사건
+#define TAIL_FILE_EVENTS (IN_MODIFY | IN_ATTRIB | IN_MOVE_SELF | IN_DELETE_SELF)
+// -F 에서 이름이 다시 나타나거나 사라지는지 디렉터리에서 기다리는 사건
+#define TAIL_DIR_EVENTS (IN_CREATE | IN_MOVED_TO | IN_MOVED_FROM | IN_DELETE | IN_ONLYDIR)
+
+static char block[TAIL_BLOCK_SIZE];
 
 typedef struct {
     char** lines;
@@ -47,13 +66,126 @@ void free_buffer(CircularBuffer* buf) {
     free(buf);
 }
 
-int tail_file(const char* filename, int num_lines) {
-    FILE* file = fopen(filename, "r");
-    if (!file) {
-        perror("tail");
+// 파일 끝에서부터 블록 단위로 거꾸로 읽으며 줄바꿈을 세어 출력을 시작할 위치를 찾는다.
+// 마지막 바이트의 줄바꿈은 마지막 줄에 속하므로 세지 않는다.
+off_t find_tail_start(int fd, off_t begin, off_t end, int num_lines) {
+    off_t pos = end;
+    int last_block = 1;
+    
+    while (pos > begin) {
+        size_t len = pos - begin < TAIL_BLOCK_SIZE ? (size_t)(pos - begin) : TAIL_BLOCK_SIZE;
+        pos -= len;
+        
+        for (size_t done = 0; done < len; ) {
+            ssize_t n = pread(fd, block + done, len - done, pos + done);
+            if (n < 0 && errno == EINTR) {
+                continue;
+            }
+            if (n <= 0) {
+                return -1;
+            }
+            done += n;
+        }
+        
+        size_t scan = len;
+        if (last_block) {
+            last_block = 0;
+            if (block[len - 1] == '\n') {
+                scan--;
+            }
+        }
+        
+        while (scan > 0) {
+            const char* newline = memrchr(block, '\n', scan);
+            if (!newline) {
+                break;
+            }
+            if (--num_lines == 0) {
+                return pos + (newline - block) + 1;
+            }
+            scan = newline - block;
+        }
+    }
+    return begin;
+}
+
+// [start, end) 를 그대로 출력한다. 입력이 일반 파일이므로 sendfile 로 커널 안에서 옮긴다.
+int send_range(int fd, off_t start, off_t end) {
+    off_t offset = start;
+    
+    fflush(stdout);     // 머리글은 stdio 로 찍혀 있다
+    
+    while (offset < end) {
+        ssize_t n = sendfile(STDOUT_FILENO, fd, &offset, end - offset);
+        if (n > 0) {
+            continue;
+        }
+        if (n == 0) {
+            return 0;
+        }
+        if (errno == EINTR) {
+            continue;
+        }
+        if (errno != EINVAL && errno != ENOSYS) {
+            return -1;
+        }
+        break;
+    }
+    
+    while (offset < end) {
+        size_t want = end - offset < TAIL_BLOCK_SIZE ? (size_t)(end - offset) : TAIL_BLOCK_SIZE;
+        ssize_t n = pread(fd, block, want, offset);
+        if (n == 0) {
+            break;
+        }
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+        for (ssize_t done = 0; done < n; ) {
+            ssize_t w = write(STDOUT_FILENO, block + done, n - done);
+            if (w < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                return -1;
+            }
+            done += w;
+        }
+        offset += n;
+    }
+    return 0;
+}
+
+// 되감을 수 있는 일반 파일이면 끝에서부터 찾아 출력 분량만큼만 읽는다.
+// 그렇지 않으면 1 을 돌려주어 처음부터 읽는 방식으로 넘어가게 한다.
+int tail_seekable(int fd, int num_lines) {
+    struct stat st;
+    
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
         return 1;
     }
     
+    off_t begin = lseek(fd, 0, SEEK_CUR);
+    if (begin < 0) {
+        return 1;
+    }
+    if (begin >= st.st_size) {
+        return 0;
+    }
+    
+    off_t start = find_tail_start(fd, begin, st.st_size, num_lines);
+    if (start < 0 || send_range(fd, start, st.st_size) != 0) {
+        perror("tail");
+        return -1;
+    }
+    lseek(fd, st.st_size, SEEK_SET);
+    return 0;
+}
+
+int tail_stream(FILE* file, int num_lines) {
     CircularBuffer* buf = create_buffer(num_lines);
     char* line = NULL;
     size_t len = 0;
@@ -66,49 +198,394 @@ int tail_file(const char* filename, int num_lines) {
     
     free(line);
     free_buffer(buf);
-    fclose(file);
     return 0;
 }
 
+// 파이프 같은 것은 쓰는 쪽이 열려 있으면 read 가 멈춰 서서 다른 파일까지 막으므로
+// 기다리지 않게 한다. 일반 파일에는 영향이 없다.
+void follow_nonblock(int fd) {
+    int flags = fd >= 0 ? fcntl(fd, F_GETFL) : -1;
+    if (flags >= 0) {
+        fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+    }
+}
+
+// keep_fd 가 있으면 -f 로 이어 읽을 수 있게 파일을 열어 둔 채 넘겨준다
+int tail_file(const char* filename, int num_lines, int* keep_fd) {
+    FILE* file = fopen(filename, "r");
+    if (!file) {
+        perror("tail");
+        return 1;
+    }
+    
+    int result = tail_seekable(fileno(file), num_lines);
+    if (result > 0) {
+        result = tail_stream(file, num_lines);
+    }
+    
+    if (keep_fd && result == 0) {
+        *keep_fd = dup(fileno(file));
+        follow_nonblock(*keep_fd);
+    }
+    fclose(file);
+    return result != 0;
+}
+
 int tail_stdin(int num_lines) {
-    CircularBuffer* buf = create_buffer(num_lines);
-    char* line = NULL;
-    size_t len = 0;
+    int result = tail_seekable(STDIN_FILENO, num_lines);
+    if (result > 0) {
+        result = tail_stream(stdin, num_lines);
+    }
+    return result != 0;
+}
+
+// 따라가기 (-f / -F)
+
+typedef struct {
+    const char* name;
+    char* dir_copy;         // dirname() 이 고쳐 쓰므로 따로 둔 사본
+    const char* dir;
+    const char* base;
+    int fd;                 // -1 이면 지금은 열려 있지 않다 (-F)
+    off_t offset;           // 여기까지 출력했다
+    dev_t dev;              // 마지막으로 따라간 파일 (같은 파일이 돌아오면 이어서 읽는다)
+    ino_t ino;
+    int wd;                 // 파일 감시, 없으면 -1
+    int dir_wd;             // -F 의 디렉터리 감시, 없으면 -1
+} follow_entry;
+
+typedef struct {
+    follow_entry* entries;
+    int count;
+    int by_name;            // -F: 이름을 따라간다 (회전, 다시 만들기)
+    int inotify_fd;
+    int last_shown;         // 마지막으로 출력한 파일 (머리글을 다시 찍을지)
+} follow_state;
+
+void follow_header(follow_state* state, int idx) {
+    if (state->count > 1 && state->last_shown != idx) {
+        printf("\n==> %s <==\n", state->entries[idx].name);
+    }
+    state->last_shown = idx;
+    fflush(stdout);
+}
+
+// 지난번 이후 늘어난 부분을 내보낸다. 일반 파일이면 sendfile 로 커널 안에서 옮기고,
+// 크기가 출력한 위치보다 줄었으면 잘린 것으로 보고 처음부터 다시 읽는다.
+int follow_copy(follow_state* state, int idx) {
+    follow_entry* e = &state->entries[idx];
+    struct stat st;
     
-    while (getline(&line, &len, stdin) != -1) {
-        add_line(buf, line);
+    if (e->fd < 0 || fstat(e->fd, &st) != 0) {
+        return -1;
     }
     
-    print_buffer(buf);
+    if (S_ISREG(st.st_mode)) {
+        if (st.st_size < e->offset) {
+            fprintf(stderr, "tail: %s: 파일이 잘렸습니다\n", e->name);
+            e->offset = 0;
+        }
+        if (st.st_size == e->offset) {
+            return 0;
+        }
+        
+        follow_header(state, idx);
+        for (;;) {
+            ssize_t n = sendfile(STDOUT_FILENO, e->fd, &e->offset, TAIL_SEND_CHUNK);
+            if (n > 0) {
+                continue;
+            }
+            if (n == 0) {
+                return 0;
+            }
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno != EINVAL && errno != ENOSYS) {
+                return -1;
+            }
+            break;
+        }
+        
+        for (;;) {
+            ssize_t n = pread(e->fd, block, sizeof(block), e->offset);
+            if (n < 0 && errno == EINTR) {
+                continue;
+            }
+            if (n <= 0) {
+                fflush(stdout);
+                return n;
+            }
+            if (fwrite(block, 1, n, stdout) != (size_t)n) {
+                return -1;
+            }
+            e->offset += n;
+        }
+    }
     
-    free(line);
-    free_buffer(buf);
-    return 0;
+    // 이름 있는 파이프 같은 것은 위치 없이 읽히는 만큼 읽는다.
+    // fd 가 O_NONBLOCK 이므로 EAGAIN 이면 지금 있는 것은 다 읽은 것이다.
+    for (;;) {
+        ssize_t n = read(e->fd, block, sizeof(block));
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            fflush(stdout);
+            return n < 0 && errno == EAGAIN ? 0 : n;
+        }
+        follow_header(state, idx);
+        if (fwrite(block, 1, n, stdout) != (size_t)n) {
+            return -1;
+        }
+    }
+}
+
+void follow_close(follow_state* state, int idx) {
+    follow_entry* e = &state->entries[idx];
+    
+    if (e->wd >= 0) {
+        // 같은 파일을 두 번 따라가면 감시가 하나로 묶이므로 마지막 것만 지운다
+        int shared = 0;
+        for (int i = 0; i < state->count; i++) {
+            if (i != idx && state->entries[i].wd == e->wd) {
+                shared = 1;
+            }
+        }
+        if (!shared) {
+            inotify_rm_watch(state->inotify_fd, e->wd);
+        }
+    }
+    if (e->fd >= 0) {
+        close(e->fd);
+    }
+    e->fd = -1;
+    e->wd = -1;
+}
+
+void follow_watch(follow_state* state, int idx) {
+    follow_entry* e = &state->entries[idx];
+    
+    e->wd = inotify_add_watch(state->inotify_fd, e->name, TAIL_FILE_EVENTS);
+    if (e->wd < 0) {
+        fprintf(stderr, "tail: %s: 감시할 수 없습니다: %s\n", e->name, strerror(errno));
+    }
+}
+
+// -F: 이름이 지금 가리키는 파일이 따라가던 파일과 다르면 옛 파일의 남은 부분을
+// 마저 내보내고 새 파일로 바꾼다. 새 파일은 처음부터, 잠시 사라졌다 돌아온 같은
+// 파일은 출력한 곳부터 이어서 내보낸다.
+void follow_check_name(follow_state* state, int idx) {
+    follow_entry* e = &state->entries[idx];
+    struct stat named, current;
+    
+    if (stat(e->name, &named) != 0) {
+        if (e->fd >= 0) {
+            follow_copy(state, idx);
+            follow_close(state, idx);
+            fprintf(stderr, "tail: %s: 파일에 접근할 수 없게 되었습니다\n", e->name);
+        }
+        return;
+    }
+    
+    int was_open = e->fd >= 0;
+    if (was_open) {
+        if (fstat(e->fd, &current) == 0 &&
+            current.st_dev == named.st_dev && current.st_ino == named.st_ino) {
+            return;
+        }
+        follow_copy(state, idx);
+        follow_close(state, idx);
+    }
+    
+    e->fd = open(e->name, O_RDONLY | O_NONBLOCK);
+    if (e->fd < 0 || fstat(e->fd, &current) != 0) {
+        return;
+    }
+    if (current.st_dev != e->dev || current.st_ino != e->ino) {
+        e->offset = 0;
+        e->dev = current.st_dev;
+        e->ino = current.st_ino;
+    }
+    follow_watch(state, idx);
+    fprintf(stderr, was_open ? "tail: %s: 새 파일로 바뀌었습니다. 새 파일을 따라갑니다\n"
+                             : "tail: %s: 파일이 나타났습니다. 따라갑니다\n", e->name);
+    follow_copy(state, idx);
+}
+
+void follow_event(follow_state* state, const struct inotify_event* event) {
+    if (event->mask & IN_Q_OVERFLOW) {
+        // 사건을 놓쳤으므로 모든 파일을 다시 확인한다
+        for (int i = 0; i < state->count; i++) {
+            if (state->by_name) {
+                follow_check_name(state, i);
+            }
+            follow_copy(state, i);
+        }
+        return;
+    }
+    
+    for (int i = 0; i < state->count; i++) {
+        follow_entry* e = &state->entries[i];
+        
+        if (event->wd == e->wd) {
+            if (event->mask & IN_IGNORED) {
+                e->wd = -1;
+                continue;
+            }
+            follow_copy(state, i);
+            if (state->by_name && (event->mask & (IN_ATTRIB | IN_MOVE_SELF | IN_DELETE_SELF))) {
+                follow_check_name(state, i);
+            }
+        }
+        
+        if (event->wd == e->dir_wd && event->len > 0 && strcmp(event->name, e->base) == 0) {
+            follow_check_name(state, i);
+        }
+    }
+}
+
+// 모든 파일을 inotify 하나에 걸어 두고 epoll 로 기다린다. 시간을 두고 다시 보는
+// 일 없이 사건이 왔을 때만 깨어나서 늘어난 부분을 내보낸다.
+int follow_files(follow_state* state) {
+    static char events[64 * 1024] __attribute__((aligned(__alignof__(struct inotify_event))));
+    
+    state->inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    int epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (state->inotify_fd < 0 || epoll_fd < 0) {
+        perror("tail");
+        return 1;
+    }
+    
+    struct epoll_event watch = { .events = EPOLLIN, .data.fd = state->inotify_fd };
+    if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, state->inotify_fd, &watch) != 0) {
+        perror("tail");
+        return 1;
+    }
+    
+    for (int i = 0; i < state->count; i++) {
+        follow_entry* e = &state->entries[i];
+        if (e->fd >= 0) {
+            follow_watch(state, i);
+        }
+        if (state->by_name) {
+            e->dir_wd = inotify_add_watch(state->inotify_fd, e->dir, TAIL_DIR_EVENTS);
+            // 감시를 거는 사이에 바뀌었을 수도 있다
+            follow_check_name(state, i);
+        }
+        follow_copy(state, i);
+    }
+    
+    for (;;) {
+        int alive = 0;
+        for (int i = 0; i < state->count; i++) {
+            follow_entry* e = &state->entries[i];
+            if (e->wd >= 0 || (state->by_name && e->dir_wd >= 0)) {
+                alive = 1;
+            }
+        }
+        if (!alive) {
+            fprintf(stderr, "tail: 따라갈 파일이 남아 있지 않습니다\n");
+            return 1;
+        }
+        
+        struct epoll_event ready;
+        if (epoll_wait(epoll_fd, &ready, 1, -1) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            perror("tail");
+            return 1;
+        }
+        
+        for (;;) {
+            ssize_t n = read(state->inotify_fd, events, sizeof(events));
+            if (n <= 0) {
+                break;
+            }
+            for (char* p = events; p < events + n; ) {
+                const struct inotify_event* event = (const struct inotify_event*)p;
+                follow_event(state, event);
+                p += sizeof(struct inotify_event) + event->len;
+            }
+        }
+    }
 }
 
 int main(int argc, char* argv[]) {
     int num_lines = 10;
     int start_idx = 1;
+    int follow = 0;
+    int by_name = 0;
     
-    if (argc > 2 && strcmp(argv[1], "-n") == 0) {
-        num_lines = atoi(argv[2]);
-        if (num_lines <= 0) {
-            num_lines = 10;
+    while (start_idx < argc) {
+        if (argc > start_idx + 1 && strcmp(argv[start_idx], "-n") == 0) {
+            num_lines = atoi(argv[start_idx + 1]);
+            if (num_lines <= 0) {
+                num_lines = 10;
+            }
+            start_idx += 2;
+        } else if (strcmp(argv[start_idx], "-f") == 0) {
+            follow = 1;
+            start_idx++;
+        } else if (strcmp(argv[start_idx], "-F") == 0) {
+            follow = 1;
+            by_name = 1;
+            start_idx++;
+        } else {
+            break;
         }
-        start_idx = 3;
     }
     
+    // 표준 입력은 따라가지 않는다 (파이프면 이미 끝까지 읽었다)
     if (argc < start_idx + 1) {
         return tail_stdin(num_lines);
     }
     
+    follow_state state = {0};
+    state.count = argc - start_idx;
+    state.by_name = by_name;
+    state.last_shown = state.count - 1;
+    if (follow) {
+        state.entries = calloc(state.count, sizeof(follow_entry));
+        if (!state.entries) {
+            perror("tail");
+            return 1;
+        }
+    }
+    
     for (int i = start_idx; i < argc; i++) {
+        follow_entry* e = follow ? &state.entries[i - start_idx] : NULL;
+        
         if (argc > start_idx + 1) {
             printf("==> %s <==\n", argv[i]);
         }
         
-        if (tail_file(argv[i], num_lines) != 0) {
-            return 1;
+        if (e) {
+            e->name = argv[i];
+            e->dir_copy = strdup(argv[i]);
+            e->dir = dirname(e->dir_copy);
+            e->base = strrchr(argv[i], '/') ? strrchr(argv[i], '/') + 1 : argv[i];
+            e->fd = -1;
+            e->wd = -1;
+            e->dir_wd = -1;
+        }
+        
+        if (tail_file(argv[i], num_lines, e ? &e->fd : NULL) != 0) {
+            // -F 는 아직 없는 파일도 나타날 때까지 기다린다
+            if (!by_name) {
+                return 1;
+            }
+        } else if (e) {
+            struct stat st;
+            e->offset = lseek(e->fd, 0, SEEK_CUR);
+            if (e->offset < 0) {
+                e->offset = 0;
+            }
+            if (fstat(e->fd, &st) == 0) {
+                e->dev = st.st_dev;
+                e->ino = st.st_ino;
+            }
         }
         
         if (i < argc - 1 && argc > start_idx + 1) {
@@ -116,5 +593,10 @@ int main(int argc, char* argv[]) {
         }
     }
     
+    if (follow) {
+        fflush(stdout);
+        return follow_files(&state);
+    }
+    
     return 0;
 } 
\ No newline at end of file
@@ -1,35 +1,245 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <stdint.h>
+#include <ctype.h>
 #include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+
+#define UNIQ_BUFFER_SIZE (1024 * 1024)   // 읽기 버퍼 하나의 기본 크기
+#define UNIQ_ARENA_SIZE (1024 * 1024)    // 해시 모드에서 서로 다른 줄을 모아 두는 블록 크기
 
 typedef struct {
     int count_mode;
+    int unsorted;           // -U 옵션: 정렬되지 않은 입력 전체에서 중복 제거 (처음 나온 순서)
+    int top;                // --top 옵션: 해시 모드 결과를 횟수 내림차순으로
+    size_t top_limit;       // --top=N 의 N (0 이면 전부)
+    size_t skip_fields;     // -f 옵션: 비교하지 않을 앞 필드 수
+    size_t skip_chars;      // -s 옵션: 그 뒤로 비교하지 않을 글자 수
+    size_t check_chars;     // -w 옵션: 비교할 최대 글자 수 (SIZE_MAX 면 줄 끝까지)
+    int ignore_case;        // -i 옵션
 } uniq_options;
 
-int process_uniq(FILE* input, uniq_options* opts) {
-    char current_line[4096];
-    char previous_line[4096];
-    int count = 0;
+// -i 비교에 쓰는 대소문자 접기 표 (main 에서 한 번 채운다)
+static unsigned char fold_table[256];
+
+// 읽기 버퍼 안의 한 줄 (개행 문자는 빼고 길이로 끝을 안다)
+typedef struct {
+    const char* text;
+    size_t len;
+} uniq_line;
+
+// 버퍼 두 개를 번갈아 채우는 줄 읽기.
+// 한 버퍼를 다 읽으면 끝나지 않은 줄 조각만 다른 버퍼로 옮기고 거기에 이어서 읽으므로,
+// 앞 버퍼를 가리키는 줄 (직전 그룹의 대표 줄) 은 복사 없이 그대로 살아 있다
+typedef struct {
+    int fd;
+    char* buffers[2];
+    size_t capacity[2];
+    int current;            // 지금 읽고 있는 버퍼
+    size_t pos;             // 아직 처리하지 않은 데이터 [pos, end)
+    size_t end;
+    int eof;
+    char* saved;            // 대표 줄이 덮어쓸 버퍼에 있을 때만 옮겨 두는 곳
+    size_t saved_capacity;
+} line_reader;
+
+void reader_init(line_reader* reader, int fd) {
+    memset(reader, 0, sizeof(*reader));
+    reader->fd = fd;
+}
+
+void reader_free(line_reader* reader) {
+    free(reader->buffers[0]);
+    free(reader->buffers[1]);
+    free(reader->saved);
+}
+
+static int in_buffer(const char* p, const char* buffer, size_t capacity) {
+    return buffer && p >= buffer && p < buffer + capacity;
+}
+
+// 읽기 버퍼 끝에 이어서 읽는다 (n: 읽은 바이트, 0: 파일 끝, -1: 오류)
+ssize_t reader_read(line_reader* reader) {
+    int current = reader->current;
+    
+    for (;;) {
+        ssize_t n = read(reader->fd, reader->buffers[current] + reader->end, reader->capacity[current] - reader->end);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n == 0) {
+            reader->eof = 1;
+        } else if (n > 0) {
+            reader->end += n;
+        }
+        return n;
+    }
+}
+
+// 더 읽는다. 지금 버퍼에 빈 곳이 없으면 다른 버퍼로 옮기는데,
+// keep 이 그 버퍼를 가리키면 (한 그룹이 버퍼 하나를 다 채운 드문 경우) saved 로 옮겨 둔다
+int reader_fill(line_reader* reader, uniq_line* keep) {
+    int next = 1 - reader->current;
+    size_t partial = reader->end - reader->pos;
+    
+    if (reader->end < reader->capacity[reader->current]) {
+        return reader_read(reader) < 0 ? -1 : 0;
+    }
+    
+    if (keep && in_buffer(keep->text, reader->buffers[next], reader->capacity[next])) {
+        if (keep->len > reader->saved_capacity) {
+            char* temp = realloc(reader->saved, keep->len);
+            if (!temp) {
+                return -1;
+            }
+            reader->saved = temp;
+            reader->saved_capacity = keep->len;
+        }
+        memcpy(reader->saved, keep->text, keep->len);
+        keep->text = reader->saved;
+    }
+    
+    // 줄이 버퍼보다 길면 버퍼를 키운다
+    size_t capacity = reader->capacity[next] ? reader->capacity[next] : UNIQ_BUFFER_SIZE;
+    while (capacity < partial * 2) {
+        capacity *= 2;
+    }
+    if (capacity != reader->capacity[next]) {
+        char* temp = realloc(reader->buffers[next], capacity);
+        if (!temp) {
+            return -1;
+        }
+        reader->buffers[next] = temp;
+        reader->capacity[next] = capacity;
+    }
+    
+    if (partial > 0) {
+        memcpy(reader->buffers[next], reader->buffers[reader->current] + reader->pos, partial);
+    }
+    reader->current = next;
+    reader->pos = 0;
+    reader->end = partial;
+    return reader_read(reader) < 0 ? -1 : 0;
+}
+
+// 다음 줄을 line 에 담는다 (1: 줄 있음, 0: 끝, -1: 오류).
+// keep 은 다음 호출까지 살아 있어야 하는 줄로, 필요하면 가리키는 곳이 바뀐다
+int reader_next(line_reader* reader, uniq_line* line, uniq_line* keep) {
+    size_t scanned = reader->pos;
+    
+    for (;;) {
+        char* buffer = reader->buffers[reader->current];
+        if (buffer && scanned < reader->end) {
+            char* newline = memchr(buffer + scanned, '\n', reader->end - scanned);
+            if (newline) {
+                line->text = buffer + reader->pos;
+                line->len = newline - line->text;
+                reader->pos = newline + 1 - buffer;
+                return 1;
+            }
+        }
+        
+        if (reader->eof) {
+            // 개행 없이 끝난 마지막 줄
+            if (reader->pos < reader->end) {
+                line->text = buffer + reader->pos;
+                line->len = reader->end - reader->pos;
+                reader->pos = reader->end;
+                return 1;
+            }
+            return 0;
+        }
+        
+        size_t offset = reader->end - reader->pos;     // 이미 찾아본 부분은 다시 보지 않는다
+        if (reader_fill(reader, keep) != 0) {
+            return -1;
+        }
+        scanned = reader->pos + offset;
+    }
+}
+
+static inline int is_blank(char c) {
+    return c == ' ' || c == '\t';
+}
+
+// 줄에서 비교할 부분: -f 필드 (공백 다음 공백 아닌 글자들), -s 글자를 건너뛰고 -w 글자까지.
+// 줄 버퍼 안의 위치만 돌려주므로 복사는 없다
+uniq_line line_key(const uniq_line* line, const uniq_options* opts) {
+    const char* p = line->text;
+    const char* end = line->text + line->len;
+    
+    for (size_t field = 0; field < opts->skip_fields && p < end; field++) {
+        while (p < end && is_blank(*p)) {
+            p++;
+        }
+        while (p < end && !is_blank(*p)) {
+            p++;
+        }
+    }
+    p += (size_t)(end - p) < opts->skip_chars ? (size_t)(end - p) : opts->skip_chars;
+    
+    uniq_line key = { p, (size_t)(end - p) };
+    if (key.len > opts->check_chars) {
+        key.len = opts->check_chars;
+    }
+    return key;
+}
+
+int keys_equal(const uniq_line* a, const uniq_line* b, const uniq_options* opts) {
+    if (a->len != b->len) {
+        return 0;
+    }
+    if (!opts->ignore_case) {
+        return memcmp(a->text, b->text, a->len) == 0;
+    }
+    
+    const unsigned char* x = (const unsigned char*)a->text;
+    const unsigned char* y = (const unsigned char*)b->text;
+    for (size_t i = 0; i < a->len; i++) {
+        if (x[i] != y[i] && fold_table[x[i]] != fold_table[y[i]]) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+void print_line(const uniq_line* line, size_t count, const uniq_options* opts) {
+    if (opts->count_mode) {
+        printf("%7zu ", count);
+    }
+    fwrite(line->text, 1, line->len, stdout);
+    putchar('\n');
+}
+
+int process_uniq(int fd, uniq_options* opts) {
+    line_reader reader;
+    uniq_line current;
+    uniq_line previous = {0};
+    uniq_line previous_key = {0};
+    size_t key_offset = 0;  // 대표 줄 안에서 키가 시작하는 위치
+    size_t count = 0;
     int first_line = 1;
+    int status;
     
-    previous_line[0] = '\0';
+    reader_init(&reader, fd);
     
-    while (fgets(current_line, sizeof(current_line), input) != NULL) {
-        size_t len = strlen(current_line);
-        if (len > 0 && current_line[len-1] == '\n') {
-            current_line[len-1] = '\0';
+    // 직전 그룹의 대표 줄은 previous 로 들고 있고, 다음 줄은 버퍼를 가리키기만 한다
+    // 대표 줄이 saved 로 옮겨질 수 있으므로 키는 대표 줄 안의 위치로 기억한다
+    while ((status = reader_next(&reader, &current, first_line ? NULL : &previous)) > 0) {
+        uniq_line key = line_key(&current, opts);
+        if (!first_line) {
+            previous_key.text = previous.text + key_offset;
         }
         
-        if (first_line || strcmp(current_line, previous_line) != 0) {
+        if (first_line || !keys_equal(&key, &previous_key, opts)) {
             if (!first_line) {
-                if (opts->count_mode) {
-                    printf("%7d %s\n", count, previous_line);
-                } else {
-                    printf("%s\n", previous_line);
-                }
+                print_line(&previous, count, opts);
             }
-            strcpy(previous_line, current_line);
+            previous = current;
+            previous_key = key;
+            key_offset = key.text - current.text;
             count = 1;
             first_line = 0;
         } else {
@@ -38,47 +248,324 @@ int process_uniq(FILE* input, uniq_options* opts) {
     }
     
     if (!first_line) {
-        if (opts->count_mode) {
-            printf("%7d %s\n", count, previous_line);
+        print_line(&previous, count, opts);
+    }
+    reader_free(&reader);
+    
+    if (status < 0) {
+        fprintf(stderr, "uniq: 읽기 오류\n");
+        return 1;
+    }
+    return 0;
+}
+
+// 해시 모드에서 서로 다른 줄 하나 (entries 배열은 처음 나온 순서)
+typedef struct {
+    const char* text;       // 아레나에 복사해 둔 줄
+    size_t len;
+    size_t key_offset;      // 그 안에서 비교하는 부분
+    size_t key_len;
+    size_t count;
+} uniq_entry;
+
+// 열린 주소 해시 테이블의 칸: 줄의 64비트 지문과 entries 번호 + 1 (0 이면 빈 칸)
+// 지문이 같을 때만 entries 의 줄을 길이 + memcmp 로 확인한다
+typedef struct {
+    uint64_t hash;
+    size_t index;
+} uniq_slot;
+
+typedef struct {
+    uniq_entry* entries;
+    size_t count;
+    size_t capacity;
+    uniq_slot* slots;
+    size_t slot_mask;       // 칸 수 - 1 (2의 거듭제곱)
+    char** blocks;          // 줄 내용을 담는 아레나 블록들
+    size_t block_count;
+    size_t block_capacity;
+    size_t block_used;      // 마지막 블록에서 쓴 바이트 수
+    size_t block_size;
+} uniq_table;
+
+static inline uint64_t hash_mix(uint64_t h) {
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return h;
+}
+
+// 8바이트씩 섞는 줄 해시 (-i 면 접기 표를 거친 바이트로 만든다)
+uint64_t line_hash(const char* text, size_t len, int ignore_case) {
+    uint64_t h = 0x9e3779b97f4a7c15ULL ^ len;
+    size_t i = 0;
+    
+    for (; i + 8 <= len; i += 8) {
+        uint64_t word;
+        if (ignore_case) {
+            word = 0;
+            for (int j = 0; j < 8; j++) {
+                word |= (uint64_t)fold_table[(unsigned char)text[i + j]] << (8 * j);
+            }
         } else {
-            printf("%s\n", previous_line);
+            memcpy(&word, text + i, 8);
+        }
+        h = (h ^ hash_mix(word)) * 0x9e3779b97f4a7c15ULL;
+    }
+    if (i < len) {
+        uint64_t word = 0;
+        for (int j = 0; i + j < len; j++) {
+            unsigned char c = (unsigned char)text[i + j];
+            word |= (uint64_t)(ignore_case ? fold_table[c] : c) << (8 * j);
         }
+        h = (h ^ hash_mix(word)) * 0x9e3779b97f4a7c15ULL;
+    }
+    return hash_mix(h);
+}
+
+void table_free(uniq_table* table) {
+    for (size_t i = 0; i < table->block_count; i++) {
+        free(table->blocks[i]);
+    }
+    free(table->blocks);
+    free(table->entries);
+    free(table->slots);
+}
+
+// 처음 나온 줄을 아레나 블록에 복사한다
+const char* table_store(uniq_table* table, const char* text, size_t len) {
+    if (table->block_count == 0 || table->block_used + len > table->block_size) {
+        if (table->block_count >= table->block_capacity) {
+            size_t capacity = table->block_capacity ? table->block_capacity * 2 : 16;
+            char** temp = realloc(table->blocks, capacity * sizeof(char*));
+            if (!temp) {
+                return NULL;
+            }
+            table->blocks = temp;
+            table->block_capacity = capacity;
+        }
+        
+        size_t size = len > UNIQ_ARENA_SIZE ? len : UNIQ_ARENA_SIZE;
+        char* block = malloc(size ? size : 1);
+        if (!block) {
+            return NULL;
+        }
+        table->blocks[table->block_count++] = block;
+        table->block_used = 0;
+        table->block_size = size;
     }
     
+    char* copy = table->blocks[table->block_count - 1] + table->block_used;
+    memcpy(copy, text, len);
+    table->block_used += len;
+    return copy;
+}
+
+// 칸 수를 두 배로 늘리고 지문만으로 다시 배치한다 (줄 내용은 다시 보지 않는다)
+int table_grow(uniq_table* table) {
+    size_t size = table->slots ? (table->slot_mask + 1) * 2 : 1024;
+    uniq_slot* slots = calloc(size, sizeof(uniq_slot));
+    if (!slots) {
+        return -1;
+    }
+    
+    for (size_t i = 0; table->slots && i <= table->slot_mask; i++) {
+        if (table->slots[i].index) {
+            size_t pos = table->slots[i].hash & (size - 1);
+            while (slots[pos].index) {
+                pos = (pos + 1) & (size - 1);
+            }
+            slots[pos] = table->slots[i];
+        }
+    }
+    free(table->slots);
+    table->slots = slots;
+    table->slot_mask = size - 1;
     return 0;
 }
 
+// 줄을 세거나 처음 나왔으면 새로 넣는다
+int table_add(uniq_table* table, const uniq_line* line, const uniq_options* opts) {
+    // 칸이 절반 넘게 차면 늘린다
+    if (!table->slots || table->count * 2 >= table->slot_mask + 1) {
+        if (table_grow(table) != 0) {
+            return -1;
+        }
+    }
+    
+    uniq_line key = line_key(line, opts);
+    uint64_t hash = line_hash(key.text, key.len, opts->ignore_case);
+    size_t pos = hash & table->slot_mask;
+    
+    while (table->slots[pos].index) {
+        if (table->slots[pos].hash == hash) {
+            uniq_entry* entry = &table->entries[table->slots[pos].index - 1];
+            uniq_line entry_key = { entry->text + entry->key_offset, entry->key_len };
+            if (keys_equal(&entry_key, &key, opts)) {
+                entry->count++;
+                return 0;
+            }
+        }
+        pos = (pos + 1) & table->slot_mask;
+    }
+    
+    if (table->count >= table->capacity) {
+        size_t capacity = table->capacity ? table->capacity * 2 : 1024;
+        uniq_entry* temp = realloc(table->entries, capacity * sizeof(uniq_entry));
+        if (!temp) {
+            return -1;
+        }
+        table->entries = temp;
+        table->capacity = capacity;
+    }
+    
+    const char* copy = table_store(table, line->text, line->len);
+    if (!copy) {
+        return -1;
+    }
+    uniq_entry* entry = &table->entries[table->count++];
+    entry->text = copy;
+    entry->len = line->len;
+    entry->key_offset = key.text - line->text;
+    entry->key_len = key.len;
+    entry->count = 1;
+    table->slots[pos].hash = hash;
+    table->slots[pos].index = table->count;
+    return 0;
+}
+
+// --top 정렬: 횟수 내림차순, 같으면 처음 나온 순서
+int compare_count(const void* a, const void* b) {
+    const uniq_entry* x = *(const uniq_entry* const*)a;
+    const uniq_entry* y = *(const uniq_entry* const*)b;
+    if (x->count != y->count) {
+        return x->count > y->count ? -1 : 1;
+    }
+    return x < y ? -1 : (x > y);
+}
+
+// -U, --top: 입력이 정렬되어 있지 않아도 전체에서 같은 줄을 모은다.
+// 줄마다 지문으로 해시 테이블을 찾고, 처음 나온 줄만 아레나에 복사해 둔다
+int process_unsorted(int fd, uniq_options* opts) {
+    line_reader reader;
+    uniq_table table = {0};
+    uniq_line line;
+    int status;
+    int ret = 0;
+    
+    reader_init(&reader, fd);
+    while ((status = reader_next(&reader, &line, NULL)) > 0) {
+        if (table_add(&table, &line, opts) != 0) {
+            fprintf(stderr, "uniq: 메모리 할당 실패\n");
+            ret = 1;
+            break;
+        }
+    }
+    reader_free(&reader);
+    if (status < 0) {
+        fprintf(stderr, "uniq: 읽기 오류\n");
+        ret = 1;
+    }
+    
+    if (ret == 0 && opts->top) {
+        uniq_entry** order = malloc((table.count ? table.count : 1) * sizeof(uniq_entry*));
+        if (!order) {
+            fprintf(stderr, "uniq: 메모리 할당 실패\n");
+            ret = 1;
+        } else {
+            size_t limit = opts->top_limit && opts->top_limit < table.count ? opts->top_limit : table.count;
+            for (size_t i = 0; i < table.count; i++) {
+                order[i] = &table.entries[i];
+            }
+            qsort(order, table.count, sizeof(uniq_entry*), compare_count);
+            for (size_t i = 0; i < limit; i++) {
+                uniq_line out = { order[i]->text, order[i]->len };
+                print_line(&out, order[i]->count, opts);
+            }
+            free(order);
+        }
+    } else if (ret == 0) {
+        for (size_t i = 0; i < table.count; i++) {
+            uniq_line out = { table.entries[i].text, table.entries[i].len };
+            print_line(&out, table.entries[i].count, opts);
+        }
+    }
+    
+    table_free(&table);
+    return ret;
+}
+
 int main(int argc, char* argv[]) {
     uniq_options opts = {0};
-    FILE* input = stdin;
+    int input = 0;
     int i;
     char* filename = NULL;
     
+    opts.check_chars = SIZE_MAX;
+    
     for (i = 1; i < argc; i++) {
         if (strcmp(argv[i], "-c") == 0) {
             opts.count_mode = 1;
-        } else if (argv[i][0] == '-') {
+        } else if (strcmp(argv[i], "-i") == 0) {
+            opts.ignore_case = 1;
+        } else if (strncmp(argv[i], "-f", 2) == 0 || strncmp(argv[i], "-s", 2) == 0 ||
+                   strncmp(argv[i], "-w", 2) == 0) {
+            char option = argv[i][1];
+            const char* value = argv[i][2] ? argv[i] + 2 : (i + 1 < argc ? argv[++i] : NULL);
+            char* end;
+            size_t n = value ? strtoul(value, &end, 10) : 0;
+            if (!value || end == value || *end != '\0') {
+                fprintf(stderr, "uniq: -%c 옵션에는 숫자가 필요합니다\n", option);
+                return 2;
+            }
+            if (option == 'f') {
+                opts.skip_fields = n;
+            } else if (option == 's') {
+                opts.skip_chars = n;
+            } else {
+                opts.check_chars = n;
+            }
+        } else if (strcmp(argv[i], "-U") == 0 || strcmp(argv[i], "--unsorted") == 0) {
+            opts.unsorted = 1;
+        } else if (strcmp(argv[i], "--top") == 0 || strncmp(argv[i], "--top=", 6) == 0) {
+            opts.unsorted = 1;
+            opts.top = 1;
+            if (argv[i][5] == '=') {
+                char* end;
+                opts.top_limit = strtoul(argv[i] + 6, &end, 10);
+                if (end == argv[i] + 6 || *end != '\0') {
+                    fprintf(stderr, "uniq: 잘못된 개수: %s\n", argv[i] + 6);
+                    return 2;
+                }
+            }
+        } else if (argv[i][0] == '-' && argv[i][1] != '\0') {
             fprintf(stderr, "uniq: 알 수 없는 옵션: %s\n", argv[i]);
-            fprintf(stderr, "사용법: uniq [-c] [파일]\n");
+            fprintf(stderr, "사용법: uniq [-c] [-i] [-f N] [-s N] [-w N] [-U] [--top[=N]] [파일]\n");
             return 2;
         } else {
             filename = argv[i];
         }
     }
     
-    if (filename) {
-        input = fopen(filename, "r");
-        if (!input) {
+    for (i = 0; i < 256; i++) {
+        fold_table[i] = (unsigned char)tolower(i);
+    }
+    
+    if (filename && strcmp(filename, "-") != 0) {
+        input = open(filename, O_RDONLY);
+        if (input < 0) {
             fprintf(stderr, "uniq: %s: 파일을 열 수 없습니다\n", filename);
             return 1;
         }
     }
     
-    int result = process_uniq(input, &opts);
+    int result = opts.unsorted ? process_unsorted(input, &opts) : process_uniq(input, &opts);
     
-    if (input != stdin) {
-        fclose(input);
+    if (input != 0) {
+        close(input);
     }
     
     return result;
-} 
\ No newline at end of file
+}
@@ -3,79 +3,328 @@
 #include <string.h>
 #include <ctype.h>
 #include <unistd.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define WC_HAVE_X86 1
+#endif
+
+#define WC_BLOCK_SIZE (256 * 1024)   // 한 번에 읽는 블록 크기
+#define WC_PARALLEL_MIN (64L * 1024 * 1024)   // 이보다 큰 일반 파일만 나눠서 센다
+#define WC_CHUNK_MIN (16L * 1024 * 1024)      // 스레드 하나가 맡는 최소 범위
 
 typedef struct {
     long lines;
     long words;
-    long chars;
+    long chars;     // UTF-8 문자(코드 포인트) 수
+    long bytes;
 } WcCount;
 
 typedef struct {
     int show_lines;
     int show_words;
-    int show_chars;
+    int show_chars;     // -m
+    int show_bytes;     // -c
 } WcOptions;
 
-int count_words_in_line(const char* line) {
-    int word_count = 0;
-    int in_word = 0;
-    
-    for (int i = 0; line[i] != '\0'; i++) {
-        if (isspace(line[i])) {
-            in_word = 0;
-        } else {
-            if (!in_word) {
-                word_count++;
-                in_word = 1;
-            }
+// 블록 단위 계산 상태: 블록 경계에서 단어가 이어지는지와 마지막 바이트
+typedef struct {
+    int in_word;
+    int last_byte;
+} WcState;
+
+// C 로케일의 isspace(): ' ', '\t', '\n', '\v', '\f', '\r'
+static inline int is_space_byte(unsigned char c) {
+    return c == ' ' || (unsigned char)(c - '\t') <= '\r' - '\t';
+}
+
+// 스칼라 버전: SIMD 블록 뒤에 남은 바이트나 x86이 아닌 환경에서 사용
+void count_scalar(const unsigned char* buf, size_t len, WcCount* count, WcState* state) {
+    for (size_t i = 0; i < len; i++) {
+        if (buf[i] == '\n') {
+            count->lines++;
+        }
+        // UTF-8 연속 바이트(10xxxxxx)가 아닌 바이트마다 문자 하나가 시작된다
+        if ((buf[i] & 0xc0) != 0x80) {
+            count->chars++;
         }
+        if (is_space_byte(buf[i])) {
+            state->in_word = 0;
+        } else if (!state->in_word) {
+            count->words++;
+            state->in_word = 1;
+        }
+    }
+}
+
+#ifdef WC_HAVE_X86
+// 공백이 아닌 바이트의 비트마스크에서 단어 시작(앞 바이트가 공백인 비트)만 센다
+static inline long count_word_starts(unsigned int nonspace, int width, WcState* state) {
+    unsigned int prev = (nonspace << 1) | (unsigned int)state->in_word;
+    state->in_word = (nonspace >> (width - 1)) & 1;
+    return __builtin_popcount(nonspace & ~prev);
+}
+
+// SSE2: 16바이트씩 개행 문자와 공백을 비교
+size_t count_sse2(const unsigned char* buf, size_t len, WcCount* count, WcState* state) {
+    const __m128i newline = _mm_set1_epi8('\n');
+    const __m128i space = _mm_set1_epi8(' ');
+    const __m128i tab = _mm_set1_epi8('\t');
+    const __m128i range = _mm_set1_epi8('\r' - '\t');
+    const __m128i continuation = _mm_set1_epi8((char)0xbf);
+    size_t i = 0;
+    
+    for (; i + 16 <= len; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i*)(buf + i));
+        __m128i shifted = _mm_sub_epi8(v, tab);
+        __m128i ctrl = _mm_cmpeq_epi8(_mm_min_epu8(shifted, range), shifted);
+        __m128i sp = _mm_or_si128(_mm_cmpeq_epi8(v, space), ctrl);
+        
+        unsigned int nl_mask = (unsigned int)_mm_movemask_epi8(_mm_cmpeq_epi8(v, newline));
+        unsigned int nonspace = ~(unsigned int)_mm_movemask_epi8(sp) & 0xffff;
+        
+        // 부호 있는 비교로 0x80..0xBF(연속 바이트)보다 큰 바이트만 센다
+        unsigned int lead = (unsigned int)_mm_movemask_epi8(_mm_cmpgt_epi8(v, continuation));
+        
+        count->lines += __builtin_popcount(nl_mask);
+        count->chars += __builtin_popcount(lead);
+        count->words += count_word_starts(nonspace, 16, state);
+    }
+    return i;
+}
+
+// AVX2: 32바이트씩, 실행 중에 CPU가 지원하는지 확인한 뒤에만 호출
+__attribute__((target("avx2,popcnt")))
+size_t count_avx2(const unsigned char* buf, size_t len, WcCount* count, WcState* state) {
+    const __m256i newline = _mm256_set1_epi8('\n');
+    const __m256i space = _mm256_set1_epi8(' ');
+    const __m256i tab = _mm256_set1_epi8('\t');
+    const __m256i range = _mm256_set1_epi8('\r' - '\t');
+    const __m256i continuation = _mm256_set1_epi8((char)0xbf);
+    size_t i = 0;
+    
+    for (; i + 32 <= len; i += 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i*)(buf + i));
+        __m256i shifted = _mm256_sub_epi8(v, tab);
+        __m256i ctrl = _mm256_cmpeq_epi8(_mm256_min_epu8(shifted, range), shifted);
+        __m256i sp = _mm256_or_si256(_mm256_cmpeq_epi8(v, space), ctrl);
+        
+        unsigned int nl_mask = (unsigned int)_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, newline));
+        unsigned int nonspace = ~(unsigned int)_mm256_movemask_epi8(sp);
+        unsigned int lead = (unsigned int)_mm256_movemask_epi8(_mm256_cmpgt_epi8(v, continuation));
+        unsigned int prev = (nonspace << 1) | (unsigned int)state->in_word;
+        
+        state->in_word = nonspace >> 31;
+        count->lines += _mm_popcnt_u32(nl_mask);
+        count->chars += _mm_popcnt_u32(lead);
+        count->words += _mm_popcnt_u32(nonspace & ~prev);
     }
+    return i;
+}
+#endif
+
+#ifdef WC_HAVE_X86
+// main() 에서 스레드를 만들기 전에 한 번 정하고, 이후로는 읽기만 한다
+static int use_avx2;
+#endif
+
+// 블록 하나를 세고 상태를 다음 블록으로 넘긴다
+void count_block(const unsigned char* buf, size_t len, WcCount* count, WcState* state) {
+    size_t done = 0;
+
+#ifdef WC_HAVE_X86
+    done = use_avx2 ? count_avx2(buf, len, count, state) : count_sse2(buf, len, count, state);
+#endif
     
-    return word_count;
+    count_scalar(buf + done, len - done, count, state);
+    count->bytes += (long)len;
+    if (len > 0) {
+        state->last_byte = buf[len - 1];
+    }
 }
 
-WcCount wc_file(const char* filename) {
-    WcCount count = {0, 0, 0};
-    FILE* file = fopen(filename, "r");
+// 파일 디스크립터를 끝까지 블록 단위로 읽어서 센다
+WcCount wc_fd(int fd) {
+    WcCount count = {0, 0, 0, 0};
+    WcState state = {0, '\n'};
+    unsigned char* buf = malloc(WC_BLOCK_SIZE);
+    ssize_t n;
     
-    if (!file) {
+    if (!buf) {
         perror("wc");
         return count;
     }
     
-    char* line = NULL;
-    size_t len = 0;
-    ssize_t read;
+    while ((n = read(fd, buf, WC_BLOCK_SIZE)) > 0) {
+        count_block(buf, (size_t)n, &count, &state);
+    }
+    if (n < 0) {
+        perror("wc");
+    }
     
-    while ((read = getline(&line, &len, file)) != -1) {
+    // 개행 문자 없이 끝나는 마지막 줄도 한 줄로 센다 (getline() 기반 구현과 같은 결과)
+    if (state.last_byte != '\n') {
         count.lines++;
-        count.chars += read;
-        count.words += count_words_in_line(line);
     }
     
-    free(line);
-    fclose(file);
+    free(buf);
     return count;
 }
 
-WcCount wc_stdin() {
-    WcCount count = {0, 0, 0};
-    char* line = NULL;
-    size_t len = 0;
-    ssize_t read;
+// 일반 파일의 한 바이트 범위를 맡아 세는 작업
+typedef struct {
+    int fd;
+    off_t start;
+    off_t end;
+    WcCount count;
+    WcState state;              // 범위가 끝났을 때 상태 (in_word: 단어 안에서 끝남)
+    int starts_in_word;         // 첫 바이트가 공백이 아님
+    int error;
+} WcChunk;
+
+void* wc_chunk_worker(void* arg) {
+    WcChunk* chunk = arg;
+    unsigned char* buf = malloc(WC_BLOCK_SIZE);
+    off_t pos = chunk->start;
     
-    while ((read = getline(&line, &len, stdin)) != -1) {
-        count.lines++;
-        count.chars += read;
-        count.words += count_words_in_line(line);
+    chunk->state.in_word = 0;
+    chunk->state.last_byte = '\n';
+    if (!buf) {
+        chunk->error = 1;
+        return NULL;
     }
     
-    free(line);
+    while (pos < chunk->end) {
+        size_t want = (size_t)(chunk->end - pos) < WC_BLOCK_SIZE ? (size_t)(chunk->end - pos) : WC_BLOCK_SIZE;
+        ssize_t n = pread(chunk->fd, buf, want, pos);
+        if (n <= 0) {
+            chunk->error = n < 0;
+            break;
+        }
+        if (pos == chunk->start) {
+            chunk->starts_in_word = !is_space_byte(buf[0]);
+        }
+        count_block(buf, (size_t)n, &chunk->count, &chunk->state);
+        pos += n;
+    }
+    
+    free(buf);
+    return NULL;
+}
+
+// 큰 일반 파일은 N개 범위로 나눠 여러 스레드에서 세고 합친다
+// 앞 범위가 단어 안에서 끝나고 다음 범위가 공백이 아닌 문자로 시작하면 같은 단어이므로 하나를 뺀다
+int wc_parallel(int fd, off_t size, WcCount* count) {
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    long threads = size / WC_CHUNK_MIN;
+    
+    if (cpus < 2 || threads < 2) {
+        return -1;
+    }
+    if (threads > cpus) {
+        threads = cpus;
+    }
+    
+    WcChunk* chunks = calloc((size_t)threads, sizeof(WcChunk));
+    pthread_t* tids = malloc(sizeof(pthread_t) * (size_t)threads);
+    if (!chunks || !tids) {
+        free(chunks);
+        free(tids);
+        return -1;
+    }
+    
+    long started = 0;
+    for (; started < threads; started++) {
+        chunks[started].fd = fd;
+        chunks[started].start = size / threads * started;
+        chunks[started].end = started == threads - 1 ? size : size / threads * (started + 1);
+        if (pthread_create(&tids[started], NULL, wc_chunk_worker, &chunks[started]) != 0) {
+            break;
+        }
+    }
+    
+    // 스레드를 만들지 못한 범위는 현재 스레드에서 처리
+    for (long i = started; i < threads; i++) {
+        chunks[i].fd = fd;
+        chunks[i].start = size / threads * i;
+        chunks[i].end = i == threads - 1 ? size : size / threads * (i + 1);
+        wc_chunk_worker(&chunks[i]);
+    }
+    for (long i = 0; i < started; i++) {
+        pthread_join(tids[i], NULL);
+    }
+    
+    WcState last = {0, '\n'};
+    int error = 0;
+    for (long i = 0; i < threads; i++) {
+        count->lines += chunks[i].count.lines;
+        count->words += chunks[i].count.words;
+        count->chars += chunks[i].count.chars;
+        count->bytes += chunks[i].count.bytes;
+        if (last.in_word && chunks[i].starts_in_word) {
+            count->words--;
+        }
+        if (chunks[i].count.bytes > 0) {
+            last = chunks[i].state;
+        }
+        error |= chunks[i].error;
+    }
+    
+    if (error) {
+        perror("wc");
+    }
+    
+    // 개행 문자 없이 끝나는 마지막 줄도 한 줄로 센다
+    if (last.last_byte != '\n') {
+        count->lines++;
+    }
+    
+    free(chunks);
+    free(tids);
+    return 0;
+}
+
+WcCount wc_file(const char* filename, const WcOptions* opts) {
+    WcCount count = {0, 0, 0, 0};
+    struct stat st;
+    int fd = open(filename, O_RDONLY);
+    
+    if (fd < 0) {
+        perror("wc");
+        return count;
+    }
+    
+    // -c 만 요청했으면 일반 파일은 읽지 않고 크기만 확인한다
+    // /proc, /sys 의 파일은 크기가 0 으로 보이므로 그때는 끝까지 읽어서 센다
+    if (opts->show_bytes && !opts->show_lines && !opts->show_words && !opts->show_chars &&
+        fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+        count.bytes = (long)st.st_size;
+        close(fd);
+        return count;
+    }
+    
+    // 파이프 등은 기존처럼 순서대로 읽는다
+    if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size >= WC_PARALLEL_MIN &&
+        wc_parallel(fd, st.st_size, &count) == 0) {
+        close(fd);
+        return count;
+    }
+    
+    posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+    count = wc_fd(fd);
+    close(fd);
     return count;
 }
 
+WcCount wc_stdin() {
+    return wc_fd(STDIN_FILENO);
+}
+
 void print_count(const WcCount* count, const char* filename, const WcOptions* opts) {
-    int default_mode = !opts->show_lines && !opts->show_words && !opts->show_chars;
+    int default_mode = !opts->show_lines && !opts->show_words && !opts->show_chars &&
+                       !opts->show_bytes;
     
     if (default_mode || opts->show_lines) {
         printf("%8ld", count->lines);
@@ -85,10 +334,14 @@ void print_count(const WcCount* count, const char* filename, const WcOptions* op
         printf("%8ld", count->words);
     }
     
-    if (default_mode || opts->show_chars) {
+    if (opts->show_chars) {
         printf("%8ld", count->chars);
     }
     
+    if (default_mode || opts->show_bytes) {
+        printf("%8ld", count->bytes);
+    }
+    
     if (filename) {
         printf(" %s", filename);
     }
@@ -97,8 +350,12 @@ void print_count(const WcCount* count, const char* filename, const WcOptions* op
 }
 
 int main(int argc, char* argv[]) {
-    WcOptions opts = {0, 0, 0};
+    WcOptions opts = {0, 0, 0, 0};
     int start_idx = 1;
+
+#ifdef WC_HAVE_X86
+    use_avx2 = __builtin_cpu_supports("avx2") && __builtin_cpu_supports("popcnt");
+#endif
     
     for (int i = 1; i < argc; i++) {
         if (argv[i][0] == '-') {
@@ -111,6 +368,9 @@ int main(int argc, char* argv[]) {
                         opts.show_words = 1;
                         break;
                     case 'c':
+                        opts.show_bytes = 1;
+                        break;
+                    case 'm':
                         opts.show_chars = 1;
                         break;
                     default:
@@ -130,16 +390,17 @@ int main(int argc, char* argv[]) {
         return 0;
     }
     
-    WcCount total = {0, 0, 0};
+    WcCount total = {0, 0, 0, 0};
     int file_count = argc - start_idx;
     
     for (int i = start_idx; i < argc; i++) {
-        WcCount count = wc_file(argv[i]);
+        WcCount count = wc_file(argv[i], &opts);
         print_count(&count, argv[i], &opts);
         
         total.lines += count.lines;
         total.words += count.words;
         total.chars += count.chars;
+        total.bytes += count.bytes;
     }
     
     if (file_count > 1) {
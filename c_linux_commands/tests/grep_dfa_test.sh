@@ -0,0 +1,37 @@
+#!/bin/sh
+# grep --dfa 의 문자 클래스 이스케이프(\s \S \w \W) 회귀 테스트
+# 사용법: sh tests/grep_dfa_test.sh   (c_linux_commands 디렉토리에서)
+
+set -u
+dir=$(cd "$(dirname "$0")/.." && pwd)
+work=$(mktemp -d)
+trap 'rm -rf "$work"' EXIT
+
+gcc -O2 -pthread "$dir/c_files/grep.c" -o "$work/grep" || exit 1
+printf 'a b\naxb\na\tb\n_x\n' > "$work/input.txt"
+
+fail=0
+
+# check <기대 출력> <grep 인수...>
+check() {
+    expected=$1
+    shift
+    for engine in "" "--dfa"; do
+        actual=$("$work/grep" $engine "$@" "$work/input.txt" | tr '\n' '|')
+        if [ "$actual" != "$expected" ]; then
+            echo "실패: grep $engine $* -> '$actual' (기대 '$expected')"
+            fail=1
+        fi
+    done
+}
+
+check 'a b|a	b|' '\s'
+check 'a b|a	b|' 'a\sb'
+check 'a b|axb|a	b|_x|' '\S'
+check 'axb|' 'a\Sb'
+check 'axb|' 'a\wb'
+check 'a b|a	b|' 'a\Wb'
+check 'a b|a	b|' 'a[[:space:]]b'
+
+[ $fail -eq 0 ] && echo "통과"
+exit $fail